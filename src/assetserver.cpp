@@ -0,0 +1,163 @@
+#include "assetserver.h"
+
+#include <QDebug>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+// requests are tiny; anything bigger than this is not for us
+static qint64 const max_request_size = 8 * 1024;
+
+// time for a peer to send its request, in ms
+static int const request_timeout = 5000;
+
+// time a reply may sit without the peer reading any of it, in ms
+static int const idle_timeout = 10000;
+
+// connections served at once
+static int const max_connections = 64;
+
+Asset::Asset(AssetServer* server, QUuid id, QUrl url)
+    : m_server(server), m_id(id), m_url(std::move(url)) { }
+
+Asset::~Asset() {
+    if (m_server) m_server->retract(m_id);
+}
+
+AssetServer::AssetServer(QString host, uint16_t port, QObject* parent)
+    : QObject(parent), m_server(new QTcpServer(this)), m_host(std::move(host)) {
+
+    auto address = m_host == "localhost" ? QHostAddress(QHostAddress::LocalHost)
+                                         : QHostAddress(QHostAddress::Any);
+
+    connect(m_server,
+            &QTcpServer::newConnection,
+            this,
+            &AssetServer::on_new_connection);
+
+    if (!m_server->listen(address, port)) {
+        qWarning() << "Unable to start asset server:"
+                   << m_server->errorString();
+        return;
+    }
+
+    qInfo() << "Serving assets on port" << m_server->serverPort();
+}
+
+AssetServer::~AssetServer() { }
+
+bool AssetServer::is_listening() const {
+    return m_server->isListening();
+}
+
+std::shared_ptr<Asset> AssetServer::publish(QByteArray data) {
+    auto id = QUuid::createUuid();
+
+    m_assets.insert(id, std::move(data));
+
+    QUrl url;
+    url.setScheme("http");
+    url.setHost(m_host);
+    url.setPort(m_server->serverPort());
+    url.setPath("/" + id.toString(QUuid::WithoutBraces));
+
+    return std::make_shared<Asset>(this, id, std::move(url));
+}
+
+void AssetServer::retract(QUuid const& id) {
+    m_assets.remove(id);
+}
+
+void AssetServer::on_new_connection() {
+    while (auto* socket = m_server->nextPendingConnection()) {
+        if (m_connections >= max_connections) {
+            socket->abort();
+            socket->deleteLater();
+            continue;
+        }
+
+        m_connections++;
+
+        connect(socket, &QObject::destroyed, this, [this]() {
+            m_connections--;
+        });
+
+        // the request must arrive within the timeout, however slowly it
+        // trickles in; the reply restarts this as it is written
+        auto* timer = new QTimer(socket);
+        timer->setSingleShot(true);
+        timer->start(request_timeout);
+
+        connect(timer, &QTimer::timeout, socket, &QTcpSocket::abort);
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            on_ready_read(socket);
+        });
+
+        connect(socket, &QTcpSocket::bytesWritten, timer, [timer]() {
+            timer->start(idle_timeout);
+        });
+
+        connect(socket,
+                &QTcpSocket::disconnected,
+                socket,
+                &QTcpSocket::deleteLater);
+    }
+}
+
+void AssetServer::on_ready_read(QTcpSocket* socket) {
+    // wait for the whole header
+    auto header = socket->peek(max_request_size);
+
+    auto header_end = header.indexOf("\r\n\r\n");
+
+    if (header_end < 0) {
+        if (header.size() >= max_request_size) socket->abort();
+        return;
+    }
+
+    socket->read(header_end + 4);
+
+    // we do not read any more from this socket
+    disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+
+    auto request_line = header.left(header.indexOf("\r\n")).split(' ');
+
+    auto reply = [socket](QByteArray status, QByteArray const& body, bool head) {
+        QByteArray r = "HTTP/1.1 " + status + "\r\n";
+        r += "Content-Type: application/octet-stream\r\n";
+        r += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        r += "Access-Control-Allow-Origin: *\r\n";
+        r += "Connection: close\r\n\r\n";
+
+        socket->write(r);
+        if (!head) socket->write(body);
+        socket->disconnectFromHost();
+    };
+
+    if (request_line.size() < 2) {
+        reply("400 Bad Request", {}, false);
+        return;
+    }
+
+    auto const& method = request_line[0];
+
+    bool const head = method == "HEAD";
+
+    if (method != "GET" and !head) {
+        reply("405 Method Not Allowed", {}, false);
+        return;
+    }
+
+    auto path = QString::fromUtf8(request_line[1]).mid(1);
+
+    auto iter = m_assets.find(QUuid::fromString(path));
+
+    if (iter == m_assets.end()) {
+        reply("404 Not Found", {}, false);
+        return;
+    }
+
+    reply("200 OK", iter.value(), head);
+}
@@ -0,0 +1,79 @@
+#ifndef ASSETSERVER_H
+#define ASSETSERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QUrl>
+#include <QUuid>
+
+#include <memory>
+
+class QTcpServer;
+class QTcpSocket;
+
+class AssetServer;
+
+///
+/// \brief A published asset. The asset is served for as long as this lives.
+///
+class Asset {
+    QPointer<AssetServer> m_server;
+    QUuid                 m_id;
+    QUrl                  m_url;
+
+public:
+    Asset(AssetServer* server, QUuid id, QUrl url);
+    ~Asset();
+
+    Asset(Asset const&)            = delete;
+    Asset& operator=(Asset const&) = delete;
+
+    QUrl const& url() const { return m_url; }
+};
+
+///
+/// \brief A minimal HTTP server for binary assets.
+///
+/// Large buffers are published here and referenced by URL, so clients can
+/// fetch them over their own connections instead of the websocket. Only GET
+/// and HEAD are understood, and every connection is closed after one reply.
+///
+/// A peer has a few seconds to send its request, and a reply is dropped if
+/// the peer stops reading for a while. Only so many connections are served at
+/// once; more are turned away.
+///
+class AssetServer : public QObject {
+    Q_OBJECT
+
+    QTcpServer* m_server;
+    QString     m_host;
+
+    QHash<QUuid, QByteArray> m_assets;
+
+    int m_connections = 0;
+
+    friend class Asset;
+    void retract(QUuid const&);
+
+    void on_new_connection();
+    void on_ready_read(QTcpSocket*);
+
+public:
+    ///
+    /// \brief Start serving.
+    ///
+    /// URLs are built with the given host name. If it is localhost, only
+    /// local connections are accepted.
+    ///
+    AssetServer(QString host, uint16_t port, QObject* parent = nullptr);
+    ~AssetServer() override;
+
+    bool is_listening() const;
+
+    /// \brief Publish data. The data is shared, not copied.
+    std::shared_ptr<Asset> publish(QByteArray data);
+};
+
+#endif // ASSETSERVER_H
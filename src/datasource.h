@@ -24,7 +24,7 @@ public:
     TableType const& table() const { return *m_table_data; }
 
     template <size_t I>
-    auto column() {
+    auto column() const {
         return std::span(std::get<I>(m_table_data->columns()));
     }
 
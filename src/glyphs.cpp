@@ -1,5 +1,9 @@
 #include "glyphs.h"
 
+#include <array>
+#include <cmath>
+#include <cstdint>
+
 
 static std::vector<glm::vec3> const source_sphere_vertex_info = {
     { -0.000000, -0.500000, -0.000000 }, { 0.361804, -0.223610, 0.262863 },
@@ -68,37 +72,344 @@ static std::vector<glm::u16vec3> const sphere_index_info = {
     { 13, 0, 16 },  { 12, 14, 2 },  { 12, 13, 14 }, { 13, 1, 14 },
 };
 
-GlyphInfo
-build_common_sphere(QString name, noo::DocumentTPtr doc, noo::TableTPtr table) {
+static std::vector<glm::vec3> const tube_vertex_info = {
+    { -0.500000, 0.000000, -1.000000 }, { 0.500000, 0.000000, -1.000000 },
+    { 0.500000, -0.866025, -0.500000 }, { -0.500000, -0.866026, -0.500000 },
+    { 0.500000, -0.866025, 0.500000 },  { -0.500000, -0.866026, 0.500000 },
+    { 0.500000, -0.000000, 1.000000 },  { -0.500000, -0.000000, 1.000000 },
+    { 0.500000, 0.866026, 0.500000 },   { -0.500000, 0.866025, 0.500000 },
+    { 0.500000, 0.866026, -0.500000 },  { -0.500000, 0.866025, -0.500000 },
+};
+
+static std::vector<glm::vec3> const tube_normal_info = {
+    { 0.0000, 0.0000, -1.0000 },  { 0.0000, -0.5000, -0.8660 },
+    { 0.0000, -1.0000, -0.0000 }, { 0.0000, -0.8660, 0.5000 },
+    { 0.0000, 0.0000, 1.0000 },   { -0.0000, 0.8660, 0.5000 },
+    { -0.0000, 0.8660, -0.5000 },
+};
+
+static std::vector<std::array<int, 6>> tube_face_info = {
+    { 1, 1, 3, 2, 4, 2 },  { 3, 3, 6, 4, 4, 3 },   { 5, 4, 8, 5, 6, 4 },
+    { 7, 5, 10, 6, 8, 5 }, { 9, 6, 12, 7, 10, 6 }, { 12, 7, 2, 1, 1, 1 },
+    { 1, 1, 2, 1, 3, 2 },  { 3, 3, 5, 4, 6, 4 },   { 5, 4, 7, 5, 8, 5 },
+    { 7, 5, 9, 6, 10, 6 }, { 9, 6, 11, 7, 12, 7 }, { 12, 7, 11, 7, 2, 1 },
+};
+
+// Coarse spheres ==============================================================
+//
+// Platonic solids for dense plots, built at compile time and pushed out to the
+// unit sphere. Faces wind counter-clockwise seen from outside.
+
+namespace {
+
+using SolidVertex = std::array<float, 3>;
+using SolidFace   = std::array<uint16_t, 3>;
+
+template <size_t V, size_t F>
+struct Solid {
+    std::array<SolidVertex, V> vertices;
+    std::array<SolidFace, F>   faces;
+};
+
+constexpr float const_sqrt(float v) {
+    float x = v > 1 ? v : 1;
+    for (int i = 0; i < 32; i++) {
+        x = .5f * (x + v / x);
+    }
+    return x;
+}
+
+template <size_t V, size_t F>
+constexpr Solid<V, F> on_unit_sphere(Solid<V, F> s) {
+    for (auto& v : s.vertices) {
+        auto l = const_sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        for (auto& c : v) {
+            c /= l;
+        }
+    }
+    return s;
+}
+
+constexpr float phi = 1.6180340f;
+
+constexpr auto icosahedron = on_unit_sphere(Solid<12, 20> {
+    .vertices = { {
+        { -1, phi, 0 },
+        { 1, phi, 0 },
+        { -1, -phi, 0 },
+        { 1, -phi, 0 },
+        { 0, -1, phi },
+        { 0, 1, phi },
+        { 0, -1, -phi },
+        { 0, 1, -phi },
+        { phi, 0, -1 },
+        { phi, 0, 1 },
+        { -phi, 0, -1 },
+        { -phi, 0, 1 },
+    } },
+    .faces    = { {
+        { 0, 11, 5 }, { 0, 5, 1 },  { 0, 1, 7 },   { 0, 7, 10 }, { 0, 10, 11 },
+        { 1, 5, 9 },  { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+        { 3, 9, 4 },  { 3, 4, 2 },  { 3, 2, 6 },   { 3, 6, 8 },  { 3, 8, 9 },
+        { 4, 9, 5 },  { 2, 4, 11 }, { 6, 2, 10 },  { 8, 6, 7 },  { 9, 8, 1 },
+    } },
+});
+
+constexpr auto octahedron = Solid<6, 8> {
+    .vertices = { {
+        { 1, 0, 0 },
+        { -1, 0, 0 },
+        { 0, 1, 0 },
+        { 0, -1, 0 },
+        { 0, 0, 1 },
+        { 0, 0, -1 },
+    } },
+    .faces    = { {
+        { 0, 2, 4 },
+        { 2, 1, 4 },
+        { 1, 3, 4 },
+        { 3, 0, 4 },
+        { 2, 0, 5 },
+        { 1, 2, 5 },
+        { 3, 1, 5 },
+        { 0, 3, 5 },
+    } },
+};
+
+constexpr auto tetrahedron = on_unit_sphere(Solid<4, 4> {
+    .vertices = { {
+        { 1, 1, 1 },
+        { 1, -1, -1 },
+        { -1, 1, -1 },
+        { -1, -1, 1 },
+    } },
+    .faces    = { {
+        { 0, 1, 2 },
+        { 0, 3, 1 },
+        { 0, 2, 3 },
+        { 1, 3, 2 },
+    } },
+});
+
+} // namespace
+
+int glyph_triangle_count(GlyphType type) {
+    switch (type) {
+    case GlyphType::Sphere: return sphere_index_info.size();
+    case GlyphType::Icosahedron: return icosahedron.faces.size();
+    case GlyphType::Octahedron: return octahedron.faces.size();
+    case GlyphType::Tetrahedron: return tetrahedron.faces.size();
+    case GlyphType::Tube: return tube_face_info.size();
+    }
+    return 0;
+}
+
+GlyphType sphere_for_budget(size_t instances, size_t triangle_budget) {
+    for (auto t : { GlyphType::Sphere,
+                    GlyphType::Icosahedron,
+                    GlyphType::Octahedron }) {
+        if (instances * glyph_triangle_count(t) <= triangle_budget) return t;
+    }
+
+    return GlyphType::Tetrahedron;
+}
+
+// Builders ====================================================================
+
+static noo::MaterialTPtr build_material(noo::DocumentTPtr    doc,
+                                        GlyphMaterial const& params) {
     noo::MaterialData mat;
-    mat.pbr_info.base_color = Qt::white;
-    mat.pbr_info.metallic   = 0;
-    mat.pbr_info.roughness  = .75;
+    mat.pbr_info.base_color = params.base_color;
+    mat.pbr_info.metallic   = params.metallic;
 
-    auto mat_ptr = create_material(doc, mat);
+    if (params.roughness) mat.pbr_info.roughness = *params.roughness;
+
+    return create_material(doc, mat);
+}
+
+// Stretch unit glyph positions by a per-axis scale. Normals take the inverse
+// of the scale, so they stay perpendicular to the surface.
+static void scale_glyph(std::vector<glm::vec3>& positions,
+                        std::vector<glm::vec3>& normals,
+                        glm::vec3               scale) {
+    for (auto& p : positions) {
+        p *= scale;
+    }
+
+    for (auto& n : normals) {
+        n = glm::normalize(n / scale);
+    }
+}
+
+static noo::MeshTPtr
+build_sphere(noo::DocumentTPtr doc, noo::MaterialTPtr mat, glm::vec3 scale) {
+    auto positions = sphere_vertex_info;
+    auto normals   = sphere_normal_info;
+
+    scale_glyph(positions, normals, scale);
 
     noo::MeshSource mesh_data;
-    mesh_data.material     = mat_ptr;
-    mesh_data.positions    = sphere_vertex_info;
-    mesh_data.normals      = sphere_normal_info;
+    mesh_data.material     = mat;
+    mesh_data.positions    = positions;
+    mesh_data.normals      = normals;
     mesh_data.indices      = std::as_bytes(std::span(sphere_index_info));
     mesh_data.index_format = noo::Format::U16;
     mesh_data.type         = noo::MeshSource::TRIANGLE;
 
-    auto mesh = create_mesh(doc, mesh_data);
+    return create_mesh(doc, mesh_data);
+}
 
-    noo::ObjectRenderableDefinition rdef {
-        .mesh = mesh,
-    };
+template <size_t V, size_t F>
+static noo::MeshTPtr build_solid(noo::DocumentTPtr  doc,
+                                 noo::MaterialTPtr  mat,
+                                 Solid<V, F> const& solid,
+                                 glm::vec3          scale) {
+    // solids are on the unit sphere, so positions double as normals
+    std::vector<glm::vec3> positions;
 
-    noo::ObjectData object_data;
-    object_data.name       = name;
-    object_data.definition = rdef;
-    object_data.transform  = glm::mat4(1);
+    for (auto const& v : solid.vertices) {
+        positions.emplace_back(v[0], v[1], v[2]);
+    }
+
+    auto normals = positions;
+
+    scale_glyph(positions, normals, scale);
+
+    noo::MeshSource mesh_data;
+    mesh_data.material     = mat;
+    mesh_data.positions    = positions;
+    mesh_data.normals      = normals;
+    mesh_data.indices      = std::as_bytes(std::span(solid.faces));
+    mesh_data.index_format = noo::Format::U16;
+    mesh_data.type         = noo::MeshSource::TRIANGLE;
 
-    if (table) { object_data.tables = QVector<noo::TableTPtr>() << table; }
+    return create_mesh(doc, mesh_data);
+}
+
+// Tubes run along X, and are stretched to each segment by the instance, so
+// only the radius is scaled. Under a non-uniform domain, the geometric mean of
+// the scale is used.
+static noo::MeshTPtr
+build_tube(noo::DocumentTPtr doc, noo::MaterialTPtr mat, glm::vec3 scale) {
+    auto const radial = std::cbrt(scale.x * scale.y * scale.z);
+
+    auto positions = tube_vertex_info;
+
+    for (auto& p : positions) {
+        p.y *= radial;
+        p.z *= radial;
+    }
+
+    std::vector<glm::vec3>    ns;
+    std::vector<glm::u16vec3> fs;
+
+    ns.resize(tube_vertex_info.size());
+    fs.reserve(tube_face_info.size());
+
+    for (auto const& a : tube_face_info) {
+        auto va = a[0] - 1;
+        auto na = a[1] - 1;
+
+        auto vb = a[2] - 1;
+        auto nb = a[3] - 1;
+
+        auto vc = a[4] - 1;
+        auto nc = a[5] - 1;
+
+        ns[va] = tube_normal_info[na];
+        ns[vb] = tube_normal_info[nb];
+        ns[vc] = tube_normal_info[nc];
+
+        fs.push_back({ va, vb, vc });
+    }
+
+    noo::MeshSource mesh_data;
+
+    mesh_data.material     = mat;
+    mesh_data.positions    = positions;
+    mesh_data.normals      = ns;
+    mesh_data.indices      = std::as_bytes(std::span(fs));
+    mesh_data.index_format = noo::Format::U16;
+    mesh_data.type         = noo::MeshSource::TRIANGLE;
+
+    return create_mesh(doc, mesh_data);
+}
+
+// Registry ====================================================================
+
+GlyphMaterial GlyphMaterial::default_for(GlyphType type) {
+    GlyphMaterial ret;
+
+    if (type != GlyphType::Tube) ret.roughness = .75;
+
+    return ret;
+}
+
+GlyphRegistry::GlyphRegistry(noo::DocumentTPtr doc) : m_doc(std::move(doc)) { }
+
+void GlyphRegistry::set_domain_scale(glm::vec3 scale) {
+    // a flat domain axis has no usable scale, so leave glyphs alone on it
+    for (int i = 0; i < 3; i++) {
+        bool usable = std::isfinite(scale[i]) and scale[i] > 0;
+
+        m_scale[i] = usable ? 1.0f / scale[i] : 1.0f;
+    }
+}
+
+Glyph GlyphRegistry::get(GlyphType type) {
+    return get(type, GlyphMaterial::default_for(type));
+}
+
+Glyph GlyphRegistry::get(GlyphType type, GlyphMaterial const& params) {
+    // drop entries nobody holds anymore
+    std::erase_if(m_entries, [](Entry const& e) { return e.mesh.expired(); });
+
+    Glyph ret;
+
+    for (auto const& e : m_entries) {
+        if (e.type != type or e.params != params) continue;
+
+        auto mesh     = e.mesh.lock();
+        auto material = e.material.lock();
+
+        if (!material) continue;
 
-    auto obj = create_object(doc, object_data);
+        if (mesh and e.scale == m_scale) return { material, mesh };
+
+        // a mesh for an older domain; the material can still be shared
+        ret.material = material;
+    }
+
+    if (!ret.material) ret.material = build_material(m_doc, params);
+
+    auto const& mat = ret.material;
+
+    switch (type) {
+    case GlyphType::Sphere: ret.mesh = build_sphere(m_doc, mat, m_scale); break;
+    case GlyphType::Icosahedron:
+        ret.mesh = build_solid(m_doc, mat, icosahedron, m_scale);
+        break;
+    case GlyphType::Octahedron:
+        ret.mesh = build_solid(m_doc, mat, octahedron, m_scale);
+        break;
+    case GlyphType::Tetrahedron:
+        ret.mesh = build_solid(m_doc, mat, tetrahedron, m_scale);
+        break;
+    case GlyphType::Tube: ret.mesh = build_tube(m_doc, mat, m_scale); break;
+    }
+
+    m_entries.push_back({ type, params, m_scale, ret.material, ret.mesh });
+
+    return ret;
+}
+
+noo::ObjectTPtr
+make_glyph_group(QString name, noo::DocumentTPtr doc, noo::ObjectTPtr parent) {
+    // instances are rendered by child objects, see InstancePages
+    noo::ObjectData object_data;
+    object_data.name      = name;
+    object_data.parent    = parent;
+    object_data.transform = glm::mat4(1);
 
-    return { mat_ptr, mesh, obj };
+    return create_object(doc, object_data);
 }
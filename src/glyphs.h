@@ -3,14 +3,84 @@
 
 #include "plotty.h"
 
-struct GlyphInfo {
+#include <QColor>
+
+#include <optional>
+#include <vector>
+
+///
+/// \brief Glyph meshes. Sphere to Tetrahedron are spheres of decreasing
+/// detail.
+///
+enum class GlyphType { Sphere, Icosahedron, Octahedron, Tetrahedron, Tube };
+
+int glyph_triangle_count(GlyphType);
+
+///
+/// \brief Pick the most detailed sphere that keeps instances under the
+/// triangle budget. The coarsest is used if none do.
+///
+GlyphType sphere_for_budget(size_t instances, size_t triangle_budget);
+
+struct GlyphMaterial {
+    QColor               base_color = Qt::white;
+    float                metallic   = 0;
+    std::optional<float> roughness; // noodles default if not set
+
+    bool operator==(GlyphMaterial const&) const = default;
+
+    /// \brief The look glyphs of a type have always had
+    static GlyphMaterial default_for(GlyphType);
+};
+
+struct Glyph {
     noo::MaterialTPtr material;
     noo::MeshTPtr     mesh;
-    noo::ObjectTPtr   obj;
 };
 
-GlyphInfo build_common_sphere(QString           name,
-                              noo::DocumentTPtr doc,
-                              noo::TableTPtr    table = {});
+///
+/// \brief Hands out glyph meshes shared by all plots of a document.
+///
+/// Glyphs are keyed by type and material. Entries are held weakly, so a glyph
+/// is released once no plot uses it, and built again on the next request.
+///
+/// Plots place glyph instances in data space, under the domain transform.
+/// Meshes are built to undo the domain scale, so a glyph keeps its size in the
+/// output space without touching the instances.
+///
+class GlyphRegistry {
+    struct Entry {
+        GlyphType                     type;
+        GlyphMaterial                 params;
+        glm::vec3                     scale;
+        std::weak_ptr<noo::MaterialT> material;
+        std::weak_ptr<noo::MeshT>     mesh;
+    };
+
+    noo::DocumentTPtr  m_doc;
+    std::vector<Entry> m_entries; // only a handful, so a list will do
+
+    glm::vec3 m_scale = glm::vec3(1); // applied to new meshes
+
+public:
+    explicit GlyphRegistry(noo::DocumentTPtr doc);
+
+    ///
+    /// \brief Set the domain scale that meshes should undo.
+    ///
+    /// Meshes handed out before keep their old scale; plots should ask for
+    /// their glyph again once the domain changes.
+    ///
+    void set_domain_scale(glm::vec3);
+
+    Glyph get(GlyphType);
+    Glyph get(GlyphType, GlyphMaterial const&);
+};
+
+///
+/// \brief Build an empty group object for a glyph plot, to hang instances off.
+///
+noo::ObjectTPtr
+make_glyph_group(QString name, noo::DocumentTPtr doc, noo::ObjectTPtr parent);
 
 #endif // GLYPHS_H
@@ -1,77 +1,272 @@
 #include "imageplot.h"
 
 #include "plotty.h"
+#include "taskpool.h"
 
-void ImagePlot::rebuild(Domain const& d) {
-    auto center = (m_top_left + m_bottom_right) / 2.0f;
+#include <QDebug>
+#include <QtEndian>
 
-    auto o = -(m_bottom_left - center);
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
-    if (!m_image_texture) {
-        m_image_texture = noo::create_texture(m_doc, m_image_data);
+QImage shrink_to_fit(QImage image, int max_size) {
+    max_size = std::max(max_size, 1);
+
+    while (image.width() > max_size or image.height() > max_size) {
+        image = image.scaled(std::max(image.width() / 2, 1),
+                             std::max(image.height() / 2, 1),
+                             Qt::IgnoreAspectRatio,
+                             Qt::SmoothTransformation);
     }
 
-    if (!m_image_mat) {
-        noo::MaterialData mat;
+    return image;
+}
 
-        mat.pbr_info.base_color = Qt::white;
-        mat.pbr_info.base_color_texture =
-            noo::TextureRef { .source = m_image_texture };
+QImage image_from_pixels(QByteArray const& pixels,
+                         int               width,
+                         int               height,
+                         int               channels) {
+    static std::array<QImage::Format, 5> const formats = {
+        QImage::Format_Invalid,   QImage::Format_Grayscale8,
+        QImage::Format_Invalid,   QImage::Format_RGB888,
+        QImage::Format_RGBA8888,
+    };
 
+    if (width <= 0 or height <= 0) return {};
+    if (channels < 1 or channels > 4) return {};
 
-        mat.pbr_info.metallic = 0;
+    auto const format = formats[channels];
 
-        m_image_mat = noo::create_material(m_doc, mat);
-    }
+    if (format == QImage::Format_Invalid) return {};
 
-    noo::MeshTPtr mesh;
+    auto const row_values = qsizetype(width) * channels;
 
-    {
-        // create a plane
+    // leave room to count the bytes of float pixels
+    auto const max_values =
+        std::numeric_limits<qsizetype>::max() / qsizetype(sizeof(float));
 
-        std::array<glm::vec3, 4> positions = {
-            m_top_left, m_bottom_left, m_bottom_right, o
-        };
+    if (row_values > max_values / height) return {};
+
+    auto const values = row_values * height;
 
-        for (auto& p : positions) {
-            p = d.transform(p);
+    // check the size against the data before allocating
+    if (pixels.size() != values and
+        pixels.size() != values * qsizetype(sizeof(float))) {
+        return {};
+    }
+
+    QImage ret(width, height, format);
+
+    if (ret.isNull()) return {};
+
+    if (pixels.size() == values) {
+        for (int y = 0; y < height; y++) {
+            std::memcpy(ret.scanLine(y),
+                        pixels.constData() + qsizetype(y) * row_values,
+                        row_values);
         }
+        return ret;
+    }
+
+    if (pixels.size() == values * qsizetype(sizeof(float))) {
+        auto const* src = pixels.constData();
 
-        std::array<glm::vec3, 4> normals;
+        for (int y = 0; y < height; y++) {
+            auto* dest = ret.scanLine(y);
 
-        for (auto& n : normals) {
-            n = glm::cross(m_top_left - m_bottom_left,
-                           m_bottom_right - m_bottom_left);
-            n = glm::normalize(n);
+            for (qsizetype i = 0; i < row_values; i++) {
+                auto f = qFromLittleEndian<float>(
+                    src + (qsizetype(y) * row_values + i) * sizeof(float));
+
+                dest[i] = uchar(std::clamp(f, 0.0f, 1.0f) * 255.0f + .5f);
+            }
         }
+        return ret;
+    }
 
-        std::array<glm::u16vec3, 2> index = {
-            glm::u16vec3 { 0, 1, 2 },
-            glm::u16vec3 { 3, 1, 2 },
-        };
+    return {};
+}
+
+static noo::MaterialData image_material_data(noo::TextureTPtr texture) {
+    noo::MaterialData mat;
+
+    mat.pbr_info.base_color = Qt::white;
+    mat.pbr_info.base_color_texture = noo::TextureRef { .source = texture };
+
+
+    mat.pbr_info.metallic = 0;
+
+    return mat;
+}
 
-        noo::MeshSource ref;
+noo::MaterialTPtr make_image_material(noo::DocumentTPtr doc,
+                                      noo::TextureTPtr  texture) {
+    return noo::create_material(doc, image_material_data(texture));
+}
+
+noo::MeshTPtr make_image_quad(noo::DocumentTPtr               doc,
+                              noo::MaterialTPtr               material,
+                              std::array<glm::vec3, 4> const& corners) {
+    auto const& [top_left, bottom_left, bottom_right, top_right] = corners;
+
+    std::array<glm::vec3, 4> normals;
+
+    for (auto& n : normals) {
+        n = glm::cross(top_left - bottom_left, bottom_right - bottom_left);
+        n = glm::normalize(n);
+    }
+
+    std::array<glm::u16vec3, 2> index = {
+        glm::u16vec3 { 0, 1, 2 },
+        glm::u16vec3 { 3, 0, 2 },
+    };
 
-        ref.positions    = positions;
-        ref.normals      = normals;
-        ref.indices      = std::as_bytes(std::span(index));
-        ref.index_format = noo::Format::U16;
-        ref.type         = noo::MeshSource::TRIANGLE;
+    noo::MeshSource ref;
 
+    ref.material     = material;
+    ref.positions    = corners;
+    ref.normals      = normals;
+    ref.indices      = std::as_bytes(std::span(index));
+    ref.index_format = noo::Format::U16;
+    ref.type         = noo::MeshSource::TRIANGLE;
+
+
+    auto key = QStringLiteral("mesh");
+
+    auto packed = noo::create_directory(doc, { { key, ref } });
+
+    return std::get<noo::MeshTPtr>(packed[key]);
+}
 
-        auto key = QStringLiteral("mesh");
+void ImagePlot::show(QImage const& image) {
+    m_image_texture = noo::create_texture(m_doc, image);
 
-        auto packed = noo::create_directory(m_doc, { { key, ref } });
+    m_host->note_outbound(image.sizeInBytes());
 
-        mesh = std::get<noo::MeshTPtr>(packed[key]);
+    // later images only swap the texture
+    if (m_mat) {
+        noo::MaterialUpdateData update {
+            .pbr_info = image_material_data(m_image_texture).pbr_info,
+        };
+
+        noo::update_material(m_mat, update);
+        return;
     }
 
+    m_mat = make_image_material(m_doc, m_image_texture);
+
+    // in data space, the domain is applied by our parent
+    auto top_right = m_top_left + m_bottom_right - m_bottom_left;
+
+    m_mesh = make_image_quad(
+        m_doc, m_mat, { m_top_left, m_bottom_left, m_bottom_right, top_right });
 
     noo::ObjectData object_data;
-    object_data.definition = noo::ObjectRenderableDefinition { .mesh = mesh };
+    object_data.parent     = m_host->data_root();
+    object_data.definition = noo::ObjectRenderableDefinition { .mesh = m_mesh };
     object_data.transform  = glm::mat4(1);
 
     m_obj = create_object(m_doc, object_data);
+
+    register_part(m_obj);
+}
+
+void ImagePlot::upload() {
+    if (m_uploading) {
+        m_upload_again = true;
+        return;
+    }
+
+    m_uploading = true;
+
+    // flip buffers, and catch the new back buffer up with the front
+    auto const front = m_back;
+    m_back           = 1 - m_back;
+
+    auto& stale = m_stale[m_back];
+
+    if (!stale.isEmpty()) {
+        auto const& src  = m_frames[front];
+        auto&       dest = m_frames[m_back];
+
+        auto const bpp   = src.depth() / 8;
+        auto const bytes = size_t(stale.width() * bpp);
+
+        for (int y = stale.top(); y <= stale.bottom(); y++) {
+            std::memcpy(dest.scanLine(y) + stale.left() * bpp,
+                        src.constScanLine(y) + stale.left() * bpp,
+                        bytes);
+        }
+
+        stale = {};
+    }
+
+    auto const max_size = m_host->options().max_texture_size;
+
+    // the task only reads the front buffer, which we leave alone until then
+    TaskPool::global().run_then(
+        this,
+        [image = m_frames[front], max_size]() {
+            return shrink_to_fit(image, max_size);
+        },
+        [this](QImage image) {
+            m_uploading = false;
+
+            show(image);
+
+            if (m_upload_again) {
+                m_upload_again = false;
+                mark_dirty();
+            }
+        },
+        [this](std::exception_ptr error) {
+            TaskPool::report_error(error);
+
+            m_uploading    = false;
+            m_upload_again = false;
+
+            // the front frame never made it out; send it all again next frame
+            auto& stale = m_stale[1 - m_back];
+            stale       = QRect(QPoint(), m_frames[m_back].size());
+
+            mark_dirty();
+        });
+}
+
+void ImagePlot::flush_data() {
+    // the front frame is behind if anything was written since the last flip
+    if (m_stale[1 - m_back].isEmpty()) return;
+
+    upload();
+}
+
+void ImagePlot::update_region(QImage const& pixels, QPoint at) {
+    auto& frame = m_frames[m_back];
+
+    auto const rect =
+        QRect(at, pixels.size()).intersected(QRect(QPoint(), frame.size()));
+
+    if (rect.isEmpty()) return;
+
+    auto const src = pixels.convertToFormat(frame.format());
+
+    auto const bpp   = frame.depth() / 8;
+    auto const bytes = size_t(rect.width() * bpp);
+
+    auto const offset = rect.topLeft() - at;
+
+    for (int y = 0; y < rect.height(); y++) {
+        std::memcpy(frame.scanLine(rect.top() + y) + rect.left() * bpp,
+                    src.constScanLine(offset.y() + y) + offset.x() * bpp,
+                    bytes);
+    }
+
+    // the other frame is now behind here
+    auto& stale = m_stale[1 - m_back];
+    stale       = stale.united(rect);
+
+    mark_dirty();
 }
 
 ImagePlot::ImagePlot(Plotty&    host,
@@ -81,15 +276,53 @@ ImagePlot::ImagePlot(Plotty&    host,
                      glm::vec3  bottom_left,
                      glm::vec3  bottom_right)
     : Plot(host, id),
-      m_image_data(image_data),
       m_top_left(top_left),
       m_bottom_left(bottom_left),
       m_bottom_right(bottom_right) {
-    rebuild(host.domain()->current_domain());
+
+    QImage placeholder(1, 1, QImage::Format_RGBA8888);
+    placeholder.fill(Qt::lightGray);
+
+    show(placeholder);
+
+    auto const max_size = host.options().max_texture_size;
+
+    TaskPool::global().run_then(
+        this,
+        [image_data = std::move(image_data), max_size]() {
+            return shrink_to_fit(QImage::fromData(image_data), max_size);
+        },
+        [this](QImage image) {
+            if (image.isNull()) {
+                qWarning() << "Unable to decode image for plot" << m_plot_id;
+                return;
+            }
+
+            show(image);
+        });
 }
 
-ImagePlot::~ImagePlot() { }
+ImagePlot::ImagePlot(Plotty&   host,
+                     int64_t   id,
+                     QImage    pixels,
+                     glm::vec3 top_left,
+                     glm::vec3 bottom_left,
+                     glm::vec3 bottom_right)
+    : Plot(host, id),
+      m_top_left(top_left),
+      m_bottom_left(bottom_left),
+      m_bottom_right(bottom_right) {
+
+    // both frames start out the same; they are detached copies, so neither
+    // is ever written while shared
+    m_frames[0] = pixels.convertToFormat(QImage::Format_RGBA8888);
+    m_frames[1] = m_frames[0].copy();
+
+    QImage placeholder(1, 1, QImage::Format_RGBA8888);
+    placeholder.fill(Qt::lightGray);
 
-void ImagePlot::domain_updated(Domain const& d) {
-    rebuild(d);
+    show(placeholder);
+    upload();
 }
+
+ImagePlot::~ImagePlot() { }
@@ -3,19 +3,42 @@
 
 #include "plot.h"
 
-class ImagePlot : public Plot {
+#include <QImage>
+
+#include <array>
 
-    QImage m_image_data;
+///
+/// \brief An image on a plane.
+///
+/// Encoded images are decoded and shrunk to the maximum texture size on the
+/// task pool; until then, a blank placeholder is shown in their place.
+///
+/// Images made from raw pixels can be updated in place. Updates are written
+/// to a back buffer, which is flipped to the front at most once a frame and
+/// turned into a texture on the task pool; updates that come in during an
+/// upload are sent together on a later frame. New frames only swap the
+/// texture of the material.
+///
+class ImagePlot : public Plot {
 
     glm::vec3 m_top_left;
     glm::vec3 m_bottom_left;
     glm::vec3 m_bottom_right;
 
-    noo::TextureTPtr  m_image_texture;
-    noo::MaterialTPtr m_image_mat;
-    noo::ObjectTPtr   m_obj;
+    noo::TextureTPtr m_image_texture;
 
-    void rebuild(Domain const&);
+    // raw images only
+    std::array<QImage, 2> m_frames;
+    std::array<QRect, 2>  m_stale; // parts of each frame behind the other
+    size_t                m_back         = 0;
+    bool                  m_uploading    = false;
+    bool                  m_upload_again = false;
+
+    void show(QImage const&);
+    void upload();
+
+protected:
+    void flush_data() override;
 
 public:
     ImagePlot(Plotty&    host,
@@ -25,9 +48,61 @@ public:
               glm::vec3  bottom_left,
               glm::vec3  bottom_right);
 
+    ImagePlot(Plotty&   host,
+              int64_t   id,
+              QImage    pixels,
+              glm::vec3 top_left,
+              glm::vec3 bottom_left,
+              glm::vec3 bottom_right);
+
     ~ImagePlot() override;
 
-    void domain_updated(Domain const&) override;
+    /// \brief If the image was made from raw pixels, and can be updated
+    bool is_raw() const { return !m_frames[0].isNull(); }
+
+    QSize size() const { return m_frames[m_back].size(); }
+
+    ///
+    /// \brief Replace part of a raw image. Pixels past the edge are dropped.
+    ///
+    void update_region(QImage const& pixels, QPoint at);
 };
 
+///
+/// \brief Build an image from raw, row-major pixels.
+///
+/// Pixels may be 8 bit or float32 channels, told apart by the size of the
+/// data; floats are clamped to [0, 1]. There may be 1 (gray), 3 (RGB) or 4
+/// (RGBA) channels.
+///
+/// \returns A null image if the data does not fit the size, or the image
+/// cannot be allocated.
+///
+QImage image_from_pixels(QByteArray const& pixels,
+                         int               width,
+                         int               height,
+                         int               channels);
+
+///
+/// \brief Make an unlit, textured material for an image.
+///
+noo::MaterialTPtr make_image_material(noo::DocumentTPtr doc,
+                                      noo::TextureTPtr  texture);
+
+///
+/// \brief Make a quad mesh, from corners in the order top left, bottom left,
+/// bottom right and top right.
+///
+noo::MeshTPtr make_image_quad(noo::DocumentTPtr               doc,
+                              noo::MaterialTPtr               material,
+                              std::array<glm::vec3, 4> const& corners);
+
+///
+/// \brief Halve an image until it fits in a square of max_size.
+///
+/// Each step is a box filtered mip level of the one before, which holds up
+/// much better than scaling down in one go.
+///
+QImage shrink_to_fit(QImage image, int max_size);
+
 #endif // IMAGEPLOT_H
@@ -0,0 +1,120 @@
+#include "instancearena.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+qsizetype const page_bytes = InstanceArena::page_size * sizeof(glm::mat4);
+
+// spares kept around, at most, by count and by size
+size_t const    max_spares      = 4;
+qsizetype const max_spare_bytes = 2 * page_bytes;
+
+// make room for bytes, doubling so steady growth does not copy every time
+void grow(QByteArray& block, qsizetype bytes) {
+    if (block.capacity() >= bytes) return;
+
+    block.reserve(std::min(page_bytes, std::max(bytes, block.capacity() * 2)));
+}
+
+} // namespace
+
+QByteArray InstanceArena::take_block(qsizetype bytes) {
+    // the smallest free spare that fits
+    auto best = m_spares.end();
+
+    for (auto iter = m_spares.begin(); iter != m_spares.end(); ++iter) {
+        if (!iter->isDetached() or iter->capacity() < bytes) continue;
+
+        if (best == m_spares.end() or iter->capacity() < best->capacity()) {
+            best = iter;
+        }
+    }
+
+    if (best != m_spares.end()) {
+        auto block = std::move(*best);
+        m_spares.erase(best);
+        return block;
+    }
+
+    QByteArray block;
+    block.reserve(bytes);
+    return block;
+}
+
+void InstanceArena::retire(QByteArray&& block) {
+    if (block.isNull()) return;
+
+    m_spares.push_back(std::move(block));
+
+    auto spare_bytes = [this]() {
+        qsizetype total = 0;
+        for (auto const& b : m_spares) {
+            total += b.capacity();
+        }
+        return total;
+    };
+
+    // drop the oldest first
+    while (m_spares.size() > max_spares or spare_bytes() > max_spare_bytes) {
+        m_spares.erase(m_spares.begin());
+    }
+}
+
+size_t InstanceArena::page_rows(size_t page) const {
+    return m_pages[page].size() / sizeof(glm::mat4);
+}
+
+void InstanceArena::resize(size_t count) {
+    auto const num_pages = (count + page_size - 1) / page_size;
+
+    while (m_pages.size() > num_pages) {
+        retire(std::move(m_pages.back()));
+        m_pages.pop_back();
+    }
+
+    while (m_pages.size() < num_pages) {
+        auto const p    = m_pages.size();
+        auto const rows = std::min(page_size, count - p * page_size);
+
+        m_pages.push_back(take_block(qsizetype(rows * sizeof(glm::mat4))));
+    }
+
+    for (size_t p = 0; p < num_pages; p++) {
+        auto const rows  = std::min(page_size, count - p * page_size);
+        auto const bytes = qsizetype(rows * sizeof(glm::mat4));
+
+        if (m_pages[p].size() == bytes) continue;
+
+        writable_page(p);
+        grow(m_pages[p], bytes);
+        m_pages[p].resize(bytes);
+    }
+
+    m_count = count;
+}
+
+glm::mat4* InstanceArena::writable_page(size_t page, bool preserve) {
+    auto& current = m_pages[page];
+
+    if (!current.isDetached()) {
+        auto fresh = take_block(current.size());
+        fresh.resize(current.size());
+
+        if (preserve and current.size()) {
+            std::memcpy(fresh.data(), current.constData(), current.size());
+        }
+
+        retire(std::exchange(current, std::move(fresh)));
+    }
+
+    return reinterpret_cast<glm::mat4*>(current.data());
+}
+
+glm::mat4 const& InstanceArena::operator[](size_t row) const {
+    auto const& p = m_pages[row / page_size];
+
+    return reinterpret_cast<glm::mat4 const*>(p.constData())[row % page_size];
+}
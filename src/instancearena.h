@@ -0,0 +1,62 @@
+#ifndef INSTANCEARENA_H
+#define INSTANCEARENA_H
+
+#include "noo_include_glm.h"
+
+#include <QByteArray>
+
+#include <vector>
+
+///
+/// \brief Instance storage, in fixed size pages of implicitly shared memory.
+///
+/// Pages are handed to buffers as is, without a copy. While a buffer still
+/// holds a page, writing to it would detach; instead, a spare block is swapped
+/// in, so uploads in flight are never touched. Blocks that come back from
+/// buffers are kept as spares, so steady updates do not allocate.
+///
+/// Blocks are sized to the rows they hold, and grow by doubling up to a full
+/// page, so small plots stay small.
+///
+class InstanceArena {
+    std::vector<QByteArray> m_pages;
+    std::vector<QByteArray> m_spares; // may still be held by buffers
+
+    size_t m_count = 0;
+
+    QByteArray take_block(qsizetype bytes);
+    void       retire(QByteArray&&);
+
+public:
+    static constexpr size_t page_size = size_t(1) << 16;
+
+    size_t size() const { return m_count; }
+    bool   empty() const { return m_count == 0; }
+
+    size_t page_count() const { return m_pages.size(); }
+
+    /// \brief The number of instances in a page
+    size_t page_rows(size_t page) const;
+
+    ///
+    /// \brief Change the number of instances.
+    ///
+    /// Existing instances are kept; new ones are left uninitialized.
+    ///
+    void resize(size_t count);
+
+    ///
+    /// \brief Get a page for writing.
+    ///
+    /// If the page is shared, it is replaced by a spare block. The old contents
+    /// are copied over only if preserve is set.
+    ///
+    glm::mat4* writable_page(size_t page, bool preserve = true);
+
+    /// \brief The storage of a page, to share without a copy
+    QByteArray const& page(size_t page) const { return m_pages[page]; }
+
+    glm::mat4 const& operator[](size_t row) const;
+};
+
+#endif // INSTANCEARENA_H
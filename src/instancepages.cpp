@@ -0,0 +1,144 @@
+#include "instancepages.h"
+
+#include "plotty.h"
+
+#include <algorithm>
+
+std::vector<RowRange> rows_to_ranges(std::vector<int64_t> rows) {
+    std::sort(rows.begin(), rows.end());
+
+    std::vector<RowRange> ret;
+
+    for (auto r : rows) {
+        if (r < 0) continue;
+
+        auto row = size_t(r);
+
+        if (!ret.empty() and row <= ret.back().end) {
+            ret.back().end = std::max(ret.back().end, row + 1);
+            continue;
+        }
+
+        ret.push_back({ row, row + 1 });
+    }
+
+    return ret;
+}
+
+InstancePages::InstancePages(Plotty&         host,
+                             noo::ObjectTPtr group,
+                             noo::MeshTPtr   mesh,
+                             QString         name)
+    : m_host(&host),
+      m_doc(host.document()),
+      m_group(std::move(group)),
+      m_mesh(std::move(mesh)),
+      m_name(std::move(name)) { }
+
+void InstancePages::upload(size_t page, InstanceArena const& instances) {
+    auto& p = m_pages[page];
+
+    // shared with the arena, not copied
+    QByteArray array = instances.page(page);
+
+    auto const length = uint64_t(array.size());
+
+    auto [buffer, asset] = m_host->create_buffer(std::move(array));
+
+    auto view = noo::create_buffer_view(m_doc,
+                                        noo::BufferViewData {
+                                            .source_buffer = buffer,
+                                            .type   = noo::ViewType::UNKNOWN,
+                                            .offset = 0,
+                                            .length = length,
+                                        });
+
+    p.count = instances.page_rows(page);
+    p.view  = view;
+    p.asset = std::move(asset);
+
+    if (p.obj) {
+        send_definition(p);
+        return;
+    }
+
+    noo::ObjectData object_data;
+    object_data.name       = QString("%1 %2").arg(m_name).arg(page);
+    object_data.parent     = m_group;
+    object_data.definition = noo::ObjectRenderableDefinition {
+        .mesh      = m_mesh,
+        .instances = noo::InstanceInfo {
+            .view   = view,
+            .stride = 0,
+        },
+    };
+    object_data.transform = glm::mat4(1);
+
+    p.obj = noo::create_object(m_doc, object_data);
+
+    // pages belong to whichever plot owns the group
+    m_host->register_object(p.obj, m_host->plot_id_of(m_group));
+}
+
+void InstancePages::send_definition(Page& p) {
+    noo::ObjectUpdateData update {
+        .definition = noo::ObjectRenderableDefinition {
+            .mesh      = m_mesh,
+            .instances = noo::InstanceInfo {
+                .view   = p.view,
+                .stride = 0,
+            },
+        },
+    };
+
+    noo::update_object(p.obj, update);
+}
+
+void InstancePages::set_mesh(noo::MeshTPtr mesh) {
+    if (mesh == m_mesh) return;
+
+    m_mesh = std::move(mesh);
+
+    for (auto& p : m_pages) {
+        if (p.obj) send_definition(p);
+    }
+}
+
+void InstancePages::update(InstanceArena const&      instances,
+                           std::span<RowRange const> dirty) {
+    auto const num_pages = instances.page_count();
+    auto const page_size = InstanceArena::page_size;
+
+    std::vector<uint8_t> send(num_pages, 0);
+
+    for (auto const& r : dirty) {
+        auto const end = std::min(r.end, instances.size());
+
+        if (r.begin >= end) continue;
+
+        auto const last = (end - 1) / page_size;
+
+        for (auto p = r.begin / page_size; p <= last; p++) {
+            send[p] = 1;
+        }
+    }
+
+    // dropping the handle of a page past the end deletes its object
+    m_pages.resize(num_pages);
+
+    for (size_t p = 0; p < num_pages; p++) {
+        auto const expected = instances.page_rows(p);
+
+        if (!m_pages[p].obj or m_pages[p].count != expected) send[p] = 1;
+
+        if (send[p]) upload(p, instances);
+    }
+}
+
+bool InstancePages::contains(noo::ObjectTPtr const& obj) const {
+    if (!obj) return false;
+
+    return std::any_of(m_pages.begin(), m_pages.end(), [&obj](Page const& p) {
+        return p.obj == obj;
+    });
+}
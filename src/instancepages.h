@@ -0,0 +1,79 @@
+#ifndef INSTANCEPAGES_H
+#define INSTANCEPAGES_H
+
+#include "instancearena.h"
+
+#include <noo_server_interface.h>
+
+#include <memory>
+#include <span>
+#include <vector>
+
+class Asset;
+class Plotty;
+
+/// \brief A half open range of rows, [begin, end)
+struct RowRange {
+    size_t begin = 0;
+    size_t end   = 0;
+};
+
+///
+/// \brief Sort rows and merge them into ranges. Negative rows are skipped.
+///
+std::vector<RowRange> rows_to_ranges(std::vector<int64_t> rows);
+
+///
+/// \brief Instances of a glyph mesh, split into fixed size pages.
+///
+/// Each arena page is a child object of the group, with its own instance
+/// buffer sharing the page memory. Updates only re-send pages that overlap a
+/// dirty range, or whose instance count changed, so small edits to a large
+/// plot stay small on the wire.
+///
+class InstancePages {
+    struct Page {
+        noo::ObjectTPtr        obj;
+        noo::BufferViewTPtr    view;
+        std::shared_ptr<Asset> asset; // set if served over HTTP
+        size_t                 count = 0;
+    };
+
+    Plotty*           m_host = nullptr;
+    noo::DocumentTPtr m_doc;
+    noo::ObjectTPtr   m_group;
+    noo::MeshTPtr     m_mesh;
+    QString           m_name;
+
+    std::vector<Page> m_pages;
+
+    void upload(size_t page, InstanceArena const& instances);
+    void send_definition(Page&);
+
+public:
+    InstancePages() = default;
+    InstancePages(Plotty&         host,
+                  noo::ObjectTPtr group,
+                  noo::MeshTPtr   mesh,
+                  QString         name);
+
+    ///
+    /// \brief Bring the pages in line with the instances.
+    ///
+    /// Pages past the end of the instances are dropped.
+    ///
+    void update(InstanceArena const&      instances,
+                std::span<RowRange const> dirty);
+
+    /// \brief Switch every page to another mesh, without re-sending instances
+    void set_mesh(noo::MeshTPtr);
+
+    noo::MeshTPtr const& mesh() const { return m_mesh; }
+
+    /// \brief If the object is one of our pages
+    bool contains(noo::ObjectTPtr const&) const;
+
+    size_t page_count() const { return m_pages.size(); }
+};
+
+#endif // INSTANCEPAGES_H
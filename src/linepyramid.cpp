@@ -0,0 +1,178 @@
+#include "linepyramid.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// stop once a level is this small
+size_t const min_level_size = 256;
+
+glm::vec3 vertex(SegmentData const& line, size_t i) {
+    return { line.px[i], line.py[i], line.pz[i] };
+}
+
+///
+/// \brief Largest-triangle-three-buckets over the vertices in source.
+///
+/// The first and last vertex are kept; the rest are split into target - 2
+/// buckets, and from each bucket we keep the vertex that makes the largest
+/// triangle with the last kept vertex and the mean of the next bucket.
+///
+std::vector<uint32_t> lttb(SegmentData const&        line,
+                           std::span<uint32_t const> source,
+                           size_t                    target) {
+    auto const n = source.size();
+
+    if (target >= n or target < 3) return { source.begin(), source.end() };
+
+    std::vector<uint32_t> ret;
+    ret.reserve(target);
+
+    ret.push_back(source.front());
+
+    double const bucket = double(n - 2) / double(target - 2);
+
+    // past the middle buckets come the last vertex, and the end
+    auto bucket_begin = [&](size_t b) {
+        if (b == target - 2) return n - 1;
+        if (b > target - 2) return n;
+        return size_t(b * bucket) + 1;
+    };
+
+    glm::vec3 a = vertex(line, source.front());
+
+    for (size_t b = 0; b < target - 2; b++) {
+        auto const begin = bucket_begin(b);
+        auto const end   = bucket_begin(b + 1);
+
+        auto const next_begin = end;
+        auto const next_end   = bucket_begin(b + 2);
+
+        glm::vec3 mean(0);
+
+        for (auto i = next_begin; i < next_end; i++) {
+            mean += vertex(line, source[i]);
+        }
+
+        mean /= float(next_end - next_begin);
+
+        float  best_area = -1;
+        size_t best      = begin;
+
+        for (auto i = begin; i < end; i++) {
+            auto p    = vertex(line, source[i]);
+            auto c    = glm::cross(p - a, mean - a);
+            auto area = glm::dot(c, c);
+
+            if (area > best_area) {
+                best_area = area;
+                best      = i;
+            }
+        }
+
+        ret.push_back(source[best]);
+        a = vertex(line, source[best]);
+    }
+
+    ret.push_back(source.back());
+
+    return ret;
+}
+
+} // namespace
+
+LinePyramid::LinePyramid(SegmentData const& line)
+    : m_vertex_count(line.vertex_count()) {
+
+    std::vector<uint32_t> all(m_vertex_count);
+    std::iota(all.begin(), all.end(), 0u);
+
+    std::span<uint32_t const> below = all;
+
+    while (below.size() > min_level_size) {
+        m_levels.push_back(lttb(line, below, below.size() / 2));
+        below = m_levels.back();
+    }
+}
+
+size_t LinePyramid::level_size(size_t level) const {
+    return level == 0 ? m_vertex_count : m_levels[level - 1].size();
+}
+
+template <class Function>
+void LinePyramid::for_each_in_level(size_t level, Function&& f) const {
+    if (level == 0) {
+        for (size_t i = 0; i < m_vertex_count; i++) {
+            f(uint32_t(i));
+        }
+        return;
+    }
+
+    for (auto i : m_levels[level - 1]) {
+        f(i);
+    }
+}
+
+std::vector<uint32_t> LinePyramid::select(SegmentData const&    line,
+                                          size_t                budget,
+                                          std::optional<Bounds> focus) const {
+    // the finest level under a budget, or the coarsest if none are
+    auto level_for = [this](size_t b) {
+        for (size_t l = 0; l < level_count(); l++) {
+            if (level_size(l) <= b) return l;
+        }
+        return level_count() - 1;
+    };
+
+    std::vector<uint32_t> ret;
+
+    if (!focus) {
+        auto const level = level_for(budget);
+
+        ret.reserve(level_size(level));
+        for_each_in_level(level, [&](uint32_t i) { ret.push_back(i); });
+
+        return ret;
+    }
+
+    auto inside = [&](uint32_t i) { return focus->contains(vertex(line, i)); };
+
+    auto const coarse = level_for(budget / 2);
+
+    std::vector<uint32_t> outline;
+
+    for_each_in_level(coarse, [&](uint32_t i) {
+        if (!inside(i)) outline.push_back(i);
+    });
+
+    auto const spare = budget > outline.size() ? budget - outline.size() : 0;
+
+    // walk down from the outline level while the focus still fits
+    auto fine = coarse;
+
+    while (fine > 0) {
+        size_t count = 0;
+        for_each_in_level(fine - 1, [&](uint32_t i) { count += inside(i); });
+
+        if (count > spare) break;
+
+        fine--;
+    }
+
+    std::vector<uint32_t> detail;
+
+    for_each_in_level(fine, [&](uint32_t i) {
+        if (inside(i)) detail.push_back(i);
+    });
+
+    ret.resize(outline.size() + detail.size());
+
+    std::merge(outline.begin(),
+               outline.end(),
+               detail.begin(),
+               detail.end(),
+               ret.begin());
+
+    return ret;
+}
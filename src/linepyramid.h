@@ -0,0 +1,47 @@
+#ifndef LINEPYRAMID_H
+#define LINEPYRAMID_H
+
+#include "plotty.h"
+#include "segmentcore.h"
+
+#include <optional>
+#include <vector>
+
+///
+/// \brief Successively coarser versions of a polyline.
+///
+/// Each level keeps about half the vertices of the one below, picked with
+/// largest-triangle-three-buckets, so peaks and turns survive. Level 0 is the
+/// line itself. Levels are lists of vertex indices into the source, so
+/// colors and scales carry over unchanged.
+///
+class LinePyramid {
+    size_t m_vertex_count = 0;
+
+    // levels past 0
+    std::vector<std::vector<uint32_t>> m_levels;
+
+    size_t level_size(size_t level) const;
+
+    template <class Function>
+    void for_each_in_level(size_t level, Function&& f) const;
+
+public:
+    LinePyramid() = default;
+    explicit LinePyramid(SegmentData const& line);
+
+    size_t level_count() const { return m_levels.size() + 1; }
+
+    ///
+    /// \brief Pick vertices to draw, no more than budget if possible.
+    ///
+    /// Without a focus, this is the finest level that fits. With a focus, half
+    /// the budget goes to a coarse outline, and the rest to the finest level
+    /// that fits inside the focus box.
+    ///
+    std::vector<uint32_t> select(SegmentData const&    line,
+                                 size_t                budget,
+                                 std::optional<Bounds> focus) const;
+};
+
+#endif // LINEPYRAMID_H
@@ -5,6 +5,8 @@
 #include <QCommandLineParser>
 #include <QLoggingCategory>
 
+#include <algorithm>
+
 
 int main(int argc, char* argv[]) {
     auto app = QCoreApplication(argc, argv);
@@ -21,13 +23,147 @@ int main(int argc, char* argv[]) {
         "d", QCoreApplication::translate("main", "Debug output"));
     parser.addOption(debug_option);
 
+    QCommandLineOption asset_option(
+        "assets",
+        QCoreApplication::translate("main",
+                                    "Serve large buffers over HTTP, instead of "
+                                    "sending them over the websocket"));
+    parser.addOption(asset_option);
+
+    QCommandLineOption asset_host_option(
+        "asset-host",
+        QCoreApplication::translate(
+            "main", "Host name clients should use to reach the asset server"),
+        "host",
+        "localhost");
+    parser.addOption(asset_host_option);
+
+    QCommandLineOption asset_port_option(
+        "asset-port",
+        QCoreApplication::translate("main", "Port for the asset server"),
+        "port",
+        "50001");
+    parser.addOption(asset_port_option);
+
+    QCommandLineOption asset_threshold_option(
+        "asset-threshold",
+        QCoreApplication::translate(
+            "main", "Buffers of at least this many bytes are served over HTTP"),
+        "bytes",
+        QString::number(1 << 20));
+    parser.addOption(asset_threshold_option);
+
+    QCommandLineOption triangle_budget_option(
+        "triangle-budget",
+        QCoreApplication::translate(
+            "main",
+            "Point plots use coarser spheres to stay under this many "
+            "triangles"),
+        "count",
+        QString::number(PlottyOptions().triangle_budget));
+    parser.addOption(triangle_budget_option);
+
+    QCommandLineOption line_threshold_option(
+        "line-threshold",
+        QCoreApplication::translate(
+            "main",
+            "Segment plots with more segments than this draw as lines instead "
+            "of tubes"),
+        "count",
+        QString::number(PlottyOptions().line_threshold));
+    parser.addOption(line_threshold_option);
+
+    QCommandLineOption vertex_budget_option(
+        "vertex-budget",
+        QCoreApplication::translate(
+            "main",
+            "Polylines with more vertices than this are decimated, or 0 for "
+            "no limit"),
+        "count",
+        QString::number(PlottyOptions().vertex_budget));
+    parser.addOption(vertex_budget_option);
+
+    QCommandLineOption max_texture_size_option(
+        "max-texture-size",
+        QCoreApplication::translate(
+            "main",
+            "Images are shrunk to fit in a square this many pixels wide"),
+        "pixels",
+        QString::number(PlottyOptions().max_texture_size));
+    parser.addOption(max_texture_size_option);
+
+    QCommandLineOption tile_size_option(
+        "tile-size",
+        QCoreApplication::translate(
+            "main", "Tiled images are cut into tiles this many pixels wide"),
+        "pixels",
+        QString::number(PlottyOptions().tile_size));
+    parser.addOption(tile_size_option);
+
+    QCommandLineOption tile_budget_option(
+        "tile-budget",
+        QCoreApplication::translate(
+            "main", "Memory for decoded image tiles, in megabytes"),
+        "megabytes",
+        QString::number(PlottyOptions().tile_memory_budget >> 20));
+    parser.addOption(tile_budget_option);
+
+    QCommandLineOption frame_interval_option(
+        "frame-interval",
+        QCoreApplication::translate(
+            "main", "Least time between plot updates, in milliseconds"),
+        "milliseconds",
+        QString::number(PlottyOptions().frame_interval));
+    parser.addOption(frame_interval_option);
+
+    QCommandLineOption rate_limit_option(
+        "rate-limit",
+        QCoreApplication::translate(
+            "main",
+            "Limit plot updates to this many MB per second; 0 for no limit"),
+        "megabytes",
+        QString::number(PlottyOptions().rate_limit >> 20));
+    parser.addOption(rate_limit_option);
+
+    QCommandLineOption rate_limit_burst_option(
+        "rate-limit-burst",
+        QCoreApplication::translate(
+            "main", "How far updates may run ahead of the rate limit, in MB"),
+        "megabytes",
+        QString::number(PlottyOptions().rate_limit_burst >> 20));
+    parser.addOption(rate_limit_burst_option);
+
     parser.process(app);
 
     bool use_debug = parser.isSet(debug_option);
 
     if (!use_debug) { QLoggingCategory::setFilterRules("*.debug=false"); }
 
-    Plotty plotty(50000);
+    auto value = [&parser](QCommandLineOption const& o) {
+        return parser.value(o);
+    };
+
+    PlottyOptions options;
+    options.use_asset_server = parser.isSet(asset_option);
+    options.asset_host       = value(asset_host_option);
+    options.asset_port       = value(asset_port_option).toUShort();
+    options.asset_threshold  = value(asset_threshold_option).toLongLong();
+    options.triangle_budget  = value(triangle_budget_option).toULongLong();
+    options.line_threshold   = value(line_threshold_option).toULongLong();
+    options.vertex_budget    = value(vertex_budget_option).toULongLong();
+    options.max_texture_size = value(max_texture_size_option).toInt();
+    options.tile_size        = std::clamp(value(tile_size_option).toInt(),
+                                   PlottyOptions::min_tile_size,
+                                   PlottyOptions::max_tile_size);
+    options.tile_memory_budget =
+        size_t(value(tile_budget_option).toULongLong()) << 20;
+    options.frame_interval = value(frame_interval_option).toInt();
+    options.rate_limit =
+        size_t(value(rate_limit_option).toULongLong()) << 20;
+    options.rate_limit_burst =
+        size_t(value(rate_limit_burst_option).toULongLong()) << 20;
+
+    Plotty plotty(options);
 
     return app.exec();
 }
@@ -44,13 +44,7 @@ static auto make_get_id_method(Plotty& host, noo::DocumentTPtr doc_ptr) {
                 noo::ErrorCodes::INVALID_REQUEST,
                 "Method should only be called on an object");
 
-        auto const& plots = host.all_plots();
-
-        for (auto const& [k, v] : plots) {
-            if (v->object() == obj) { return qint64(k); }
-        }
-
-        return -1;
+        return qint64(host.plot_id_of(obj));
     });
 
     return noo::create_method(doc_ptr, method_data);
@@ -58,7 +52,103 @@ static auto make_get_id_method(Plotty& host, noo::DocumentTPtr doc_ptr) {
 
 void Plot::domain_updated(Domain const&) { }
 
-void Plot::handle_selection(SpatialSelection const&) { }
+void Plot::mark_dirty() {
+    m_host->schedule_flush(m_plot_id);
+}
+
+void Plot::flush_data() { }
+
+void Plot::flush() {
+    // new data may move the domain, so it goes first
+    flush_data();
+
+    if (!m_domain_dirty) return;
+
+    m_domain_dirty = false;
+
+    domain_updated(m_host->domain()->current_domain());
+}
+
+std::optional<Bounds>
+Plot::selection_focus(SpatialSelection const& sel) const {
+    auto const& d = m_host->domain()->current_domain();
+
+    if (auto const* region = std::get_if<SelectRegion>(&sel)) {
+        Bounds ret;
+        ret.extend(d.inverse_transform(region->min));
+        ret.extend(d.inverse_transform(region->max));
+        return ret;
+    }
+
+    if (auto const* sphere = std::get_if<SelectSphere>(&sel)) {
+        return probe_focus(sphere->point, sphere->radius);
+    }
+
+    return std::nullopt;
+}
+
+Bounds Plot::probe_focus(glm::vec3 const& probe_point, float radius) const {
+    auto const& d = m_host->domain()->current_domain();
+
+    auto const center = d.inverse_transform(probe_point);
+    auto const extent = glm::abs(glm::vec3(radius) / d.scale());
+
+    return { center - extent, center + extent };
+}
+
+void Plot::register_part(noo::ObjectTPtr const& obj) {
+    m_host->register_object(obj, m_plot_id);
+}
+
+void Plot::show_mesh_part(noo::MeshSource const& source,
+                          size_t                 bytes,
+                          QString const&         name,
+                          noo::MeshTPtr&         mesh,
+                          noo::ObjectTPtr&       obj) {
+    mesh = noo::create_mesh(m_doc, source);
+
+    // meshes are sent inline, so count them against the rate limit
+    m_host->note_outbound(bytes);
+
+    auto definition = noo::ObjectRenderableDefinition { .mesh = mesh };
+
+    if (obj) {
+        noo::ObjectUpdateData update { .definition = definition };
+        noo::update_object(obj, update);
+        return;
+    }
+
+    noo::ObjectData object_data;
+    object_data.name       = name;
+    object_data.parent     = m_obj;
+    object_data.definition = definition;
+    object_data.transform  = glm::mat4(1);
+
+    obj = noo::create_object(m_doc, object_data);
+
+    register_part(obj);
+}
+
+void Plot::cancel_rebuild() {
+    m_rebuild_stop.request_stop();
+    m_rebuild_stop = std::stop_source();
+
+    m_rebuild_generation++;
+    m_rebuild_running = false;
+}
+
+void Plot::prepare_queries() { }
+
+std::function<void()> Plot::prepare_selection(SpatialSelection const&) {
+    return {};
+}
+
+void Plot::handle_selection(SpatialSelection const& sel) {
+    prepare_queries();
+
+    auto apply = prepare_selection(sel);
+    if (apply) apply();
+}
 
 Plot::ProbeResult Plot::handle_probe(glm::vec3 const&) {
     return {};
@@ -76,14 +166,26 @@ Plot::Plot(Plotty& host, int64_t id)
         m_get_id_method = method;
     }
 
-    connect(host.domain(), &SharedDomain::domain_updated, this, [&]() {
-        auto const& d = host.domain()->current_domain();
-        domain_updated(d);
+    connect(host.domain(), &SharedDomain::domain_updated, this, [this]() {
+        m_domain_dirty = true;
+        mark_dirty();
     });
 }
 
-Plot::~Plot() { }
+Plot::~Plot() {
+    // we are going away, so we do not care about the resulting domain change
+    disconnect(m_host->domain(), nullptr, this, nullptr);
+
+    m_host->domain()->remove_plot_bounds(m_plot_id);
+
+    // let a running rebuild end early; its result is never delivered
+    m_rebuild_stop.request_stop();
+}
 
 noo::ObjectTPtr const& Plot::object() {
     return m_obj;
 }
+
+bool Plot::owns_object(noo::ObjectTPtr const& obj) const {
+    return obj and obj == m_obj;
+}
@@ -1,11 +1,15 @@
 #ifndef PLOT_H
 #define PLOT_H
 
+#include "taskpool.h"
+
 #include <noo_server_interface.h>
 
 #include <QObject>
 
+#include <functional>
 #include <memory>
+#include <stop_token>
 
 /*!
  * \brief Compute linear interpolation
@@ -51,6 +55,7 @@ struct SpatialSelection
     using variant::variant;
 };
 
+struct Bounds;
 struct Domain;
 
 class Plotty;
@@ -72,23 +77,149 @@ protected:
 
     std::unordered_map<int, int> m_column_mapping;
 
+    bool m_domain_dirty = false;
+
+    // the newest rebuild job; older jobs are stopped, and their results
+    // dropped
+    uint64_t         m_rebuild_generation = 0;
+    std::stop_source m_rebuild_stop;
+    bool             m_rebuild_running = false;
+
     virtual void domain_updated(Domain const&);
 
+    /// \brief Have the host flush this plot on the next frame
+    void mark_dirty();
+
+    ///
+    /// \brief Apply data changes collected since the last flush.
+    ///
+    /// Table signals and the like should only note what changed and mark the
+    /// plot dirty; the rebuild and upload happen here, once per frame.
+    ///
+    virtual void flush_data();
+
+    ///
+    /// \brief The box a region or sphere selection covers, in data space.
+    ///
+    /// Selections are in the physical domain, like probes.
+    ///
+    std::optional<Bounds> selection_focus(SpatialSelection const&) const;
+
+    ///
+    /// \brief A box around a probe point, in data space.
+    ///
+    /// The probe is in the physical domain, and so is the radius.
+    ///
+    Bounds probe_focus(glm::vec3 const& probe_point, float radius) const;
+
+    ///
+    /// \brief Run a rebuild on the task pool, superseding any still running.
+    ///
+    /// The job is called with a stop token, which is set once a newer job
+    /// starts or the rebuild is cancelled; it should not touch the plot, only
+    /// what it captured. Publish gets the result on the main thread, and only
+    /// if no newer job has been started since.
+    ///
+    template <class Job, class Publish>
+    void start_rebuild(Job&& job, Publish&& publish);
+
+    /// \brief Stop any running rebuild, and drop its result
+    void cancel_rebuild();
+
+    /// \brief If a rebuild has been started, and not yet published
+    bool rebuild_running() const { return m_rebuild_running; }
+
+    /// \brief Record an object as part of this plot, for get_plot_id
+    void register_part(noo::ObjectTPtr const&);
+
+    ///
+    /// \brief Show a mesh as a single child object of the plot object.
+    ///
+    /// The mesh is made from source, and the child is created on first use,
+    /// then pointed at each new mesh. Bytes is the size of the mesh data,
+    /// which counts against the rate limit.
+    ///
+    void show_mesh_part(noo::MeshSource const& source,
+                        size_t                 bytes,
+                        QString const&         name,
+                        noo::MeshTPtr&         mesh,
+                        noo::ObjectTPtr&       obj);
+
 public:
     Plot(Plotty& host, int64_t id);
     ~Plot();
 
     noo::ObjectTPtr const& object();
 
-    virtual void handle_selection(SpatialSelection const&);
+    ///
+    /// \brief Bring the plot up to date with data and domain changes.
+    ///
+    /// This is called by the host, at most once a frame.
+    ///
+    void flush();
+
+    /// \brief If the object is the plot object, or one of its parts
+    virtual bool owns_object(noo::ObjectTPtr const&) const;
+
+    ///
+    /// \brief Get ready for prepare_selection and handle_probe.
+    ///
+    /// This is run on the main thread before they are, so they can stay read
+    /// only. Lookup structures should be brought up to date here.
+    ///
+    virtual void prepare_queries();
+
+    ///
+    /// \brief Work out what a selection hits, without changing anything.
+    ///
+    /// This may be run on a worker thread, in parallel with other plots,
+    /// after prepare_queries. The returned function applies the result, and
+    /// is run on the main thread. It may be empty if there is nothing to do.
+    ///
+    virtual std::function<void()> prepare_selection(SpatialSelection const&);
+
+    void handle_selection(SpatialSelection const&);
 
     struct ProbeResult {
         QString                  text;
         std::optional<glm::vec3> place;
     };
 
+    /// \brief Probe the plot. This may be run on a worker thread, in parallel
+    /// with other plots, after prepare_queries.
     virtual ProbeResult handle_probe(glm::vec3 const&);
 };
 
+template <class Job, class Publish>
+void Plot::start_rebuild(Job&& job, Publish&& publish) {
+    cancel_rebuild();
+
+    m_rebuild_running = true;
+
+    using Result = std::invoke_result_t<Job, std::stop_token>;
+
+    // results are passed by pointer, so they need not be copyable
+    TaskPool::global().run_then(
+        this,
+        [job = std::forward<Job>(job), stop = m_rebuild_stop.get_token()]() {
+            return std::make_shared<Result>(job(stop));
+        },
+        [this,
+         generation = m_rebuild_generation,
+         publish    = std::forward<Publish>(publish)](
+            std::shared_ptr<Result> result) mutable {
+            if (generation != m_rebuild_generation) return;
+
+            m_rebuild_running = false;
+
+            publish(std::move(*result));
+        },
+        [this, generation = m_rebuild_generation](std::exception_ptr error) {
+            TaskPool::report_error(error);
+
+            // the next rebuild starts over; until then, what is shown stays
+            if (generation == m_rebuild_generation) m_rebuild_running = false;
+        });
+}
 
 #endif // PLOT_H
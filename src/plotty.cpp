@@ -1,35 +1,148 @@
 #include "plotty.h"
 
+#include "assetserver.h"
+#include "glyphs.h"
 #include "imageplot.h"
 #include "linesegmentplot.h"
 #include "plottyrootcallbacks.h"
 #include "pointplot.h"
+#include "polylineplot.h"
 #include "simpletable.h"
 #include "tableplot.h"
+#include "tiledimageplot.h"
 
 #include "variant_tools.h"
 
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
 #include <string>
 #include <string_view>
+#include <utility>
 
 #include <QColor>
 #include <QDebug>
+#include <QSysInfo>
+#include <QTimer>
+#include <QtEndian>
 
 using namespace std::literals;
 
+// Typed array tags from RFC 8746
+enum : quint64 {
+    cbor_tag_f32_le = 85,
+    cbor_tag_f64_le = 86,
+};
+
+/// Decode a byte string of little-endian reals into a float list. Returns
+/// false if the value is not a byte string or a known typed array.
+static bool decode_real_bytes(QCborValue const& a, QVector<float>& out) {
+    bool       is_double = false;
+    QByteArray bytes;
+
+    if (a.isTag()) {
+        auto tag = quint64(a.tag());
+
+        if (tag != cbor_tag_f32_le and tag != cbor_tag_f64_le) return false;
+
+        is_double = tag == cbor_tag_f64_le;
+        bytes     = a.taggedValue().toByteArray();
+    } else if (a.isByteArray()) {
+        // untagged bytes are taken to be float32
+        bytes = a.toByteArray();
+    } else {
+        return false;
+    }
+
+    size_t const elem_size = is_double ? sizeof(double) : sizeof(float);
+
+    if (bytes.size() % elem_size != 0) {
+        throw noo::MethodException(
+            noo::ErrorCodes::INVALID_PARAMS,
+            "Binary real array size is not a multiple of the element size");
+    }
+
+    size_t const count = bytes.size() / elem_size;
+    auto const*  src   = bytes.constData();
+
+    out.resize(count);
+
+    if (!is_double) {
+        if constexpr (QSysInfo::ByteOrder == QSysInfo::LittleEndian) {
+            std::memcpy(out.data(), src, count * sizeof(float));
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                auto bits = qFromLittleEndian<quint32>(src + i * sizeof(float));
+                out[i]    = std::bit_cast<float>(bits);
+            }
+        }
+        return true;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        auto bits = qFromLittleEndian<quint64>(src + i * sizeof(double));
+        out[i]    = std::bit_cast<double>(bits);
+    }
+
+    return true;
+}
+
 struct FloatListArg {
     QVector<float> list;
 
+    // false if the argument was null or missing, as opposed to empty
+    bool given = false;
+
     FloatListArg() = default;
-    FloatListArg(QCborValue const& a) {
-        for (auto v : a.toArray()) {
+    FloatListArg(QCborValue const& a)
+        : given(!a.isNull() and !a.isUndefined()) {
+        if (decode_real_bytes(a, list)) return;
+
+        auto arr = a.toArray();
+
+        list.reserve(arr.size());
+
+        for (auto v : arr) {
             list << v.toDouble();
         }
     }
 };
 
+/// If the y and z lists are null, treat the x list as a packed Nx3 array of
+/// interleaved coordinates and split it into the three lists. Empty y and z
+/// lists are taken as given.
+static void unpack_coordinates(FloatListArg& xs,
+                               FloatListArg& ys,
+                               FloatListArg& zs) {
+    if (ys.given or zs.given) return;
+
+    if (xs.list.size() % 3 != 0) {
+        throw noo::MethodException(
+            noo::ErrorCodes::INVALID_PARAMS,
+            "Packed coordinate array must have a multiple of 3 values");
+    }
+
+    auto const count = xs.list.size() / 3;
+
+    ys.list.resize(count);
+    zs.list.resize(count);
+
+    float* x = xs.list.data();
+
+    for (qsizetype i = 0; i < count; i++) {
+        ys.list[i] = x[i * 3 + 1];
+        zs.list[i] = x[i * 3 + 2];
+        x[i]       = x[i * 3 + 0]; // safe, we never read behind ourselves
+    }
+
+    xs.list.resize(count);
+    xs.list.squeeze();
+}
+
 struct ColorListArgument {
     std::vector<glm::vec3> colors;
 
@@ -127,8 +240,8 @@ struct Scale2DListArgument {
 
             scales.resize(reals.size() / 2);
 
-            for (size_t i = 0; i < scales.size(); i += 2) {
-                scales[i] = { real_span[i + 0], real_span[i + 1] };
+            for (size_t i = 0; i < scales.size(); i++) {
+                scales[i] = { real_span[i * 2 + 0], real_span[i * 2 + 1] };
             }
             return;
         }
@@ -138,8 +251,47 @@ struct Scale2DListArgument {
 
 // Domain ======================================================================
 
+// a flat input axis (2D data, a single point) has no extent to map, so it is
+// left unscaled and parked in the middle of the output range instead of
+// letting an inf reach the root transform
+static bool domain_axis_flat(Domain const& d, int i) {
+    float in_extent = d.input_max[i] - d.input_min[i];
+
+    return !std::isfinite(in_extent) or in_extent == 0 or
+           !std::isfinite((d.output_max[i] - d.output_min[i]) / in_extent);
+}
+
 glm::vec3 Domain::transform(glm::vec3 a) const {
-    return lerp(a, input_min, input_max, output_min, output_max);
+    return a * scale() + offset();
+}
+
+glm::vec3 Domain::inverse_transform(glm::vec3 a) const {
+    return (a - offset()) / scale();
+}
+
+glm::vec3 Domain::scale() const {
+    glm::vec3 ret = (output_max - output_min) / (input_max - input_min);
+
+    for (int i = 0; i < 3; i++) {
+        if (domain_axis_flat(*this, i)) ret[i] = 1;
+    }
+
+    return ret;
+}
+
+glm::vec3 Domain::offset() const {
+    glm::vec3 ret = output_min - input_min * scale();
+
+    for (int i = 0; i < 3; i++) {
+        if (!domain_axis_flat(*this, i)) continue;
+        ret[i] = (output_min[i] + output_max[i]) * 0.5f - input_min[i];
+    }
+
+    return ret;
+}
+
+glm::mat4 Domain::matrix() const {
+    return glm::scale(glm::translate(glm::mat4(1), offset()), scale());
 }
 
 SharedDomain::SharedDomain(QObject* p) : QObject(p) { }
@@ -153,6 +305,11 @@ bool SharedDomain::domain_auto_updates() const {
 
 void SharedDomain::set_domain_auto_updates(bool b) {
     m_domain_auto = b;
+
+    // catch up with anything reported while we were not following
+    if (m_domain_auto and !m_union_bounds.empty()) {
+        apply_input_bounds(m_union_bounds.lo, m_union_bounds.hi);
+    }
 }
 
 void SharedDomain::ask_set_domain(Domain d) {
@@ -161,9 +318,58 @@ void SharedDomain::ask_set_domain(Domain d) {
     emit domain_updated();
 }
 
-void SharedDomain::ask_update_input_bounds(glm::vec3 l, glm::vec3 h) {
-    if (!m_domain_auto) return;
+void SharedDomain::update_plot_bounds(int64_t plot_id, Bounds const& b) {
+    if (b.empty()) {
+        remove_plot_bounds(plot_id);
+        return;
+    }
+
+    auto [iter, inserted] = m_plot_bounds.try_emplace(plot_id, b);
+
+    if (!inserted) {
+        if (iter->second == b) return;
+
+        // a plot that shrank may have been holding the union open
+        bool shrank = glm::any(glm::greaterThan(b.lo, iter->second.lo)) or
+                      glm::any(glm::lessThan(b.hi, iter->second.hi));
+
+        iter->second = b;
+
+        if (shrank) {
+            recompute_union();
+            return;
+        }
+    }
+
+    auto next = m_union_bounds;
+    next.extend(b);
+
+    if (next == m_union_bounds) return;
+
+    m_union_bounds = next;
+
+    if (m_domain_auto) apply_input_bounds(next.lo, next.hi);
+}
+
+void SharedDomain::remove_plot_bounds(int64_t plot_id) {
+    if (m_plot_bounds.erase(plot_id)) recompute_union();
+}
+
+void SharedDomain::recompute_union() {
+    Bounds next;
+
+    for (auto const& [id, b] : m_plot_bounds) {
+        next.extend(b);
+    }
+
+    if (next == m_union_bounds) return;
+
+    m_union_bounds = next;
 
+    if (m_domain_auto and !next.empty()) apply_input_bounds(next.lo, next.hi);
+}
+
+void SharedDomain::apply_input_bounds(glm::vec3 l, glm::vec3 h) {
     bool l_ok = glm::distance(m_current_domain.input_min, l) <=
                 std::numeric_limits<float>::epsilon();
     bool h_ok = glm::distance(m_current_domain.input_max, h) <=
@@ -349,6 +555,11 @@ auto make_set_domain_method(Plotty& p) {
     return noo::create_method(p.document().get(), m);
 }
 
+// Float list arguments may also be given as bytes, see FloatListArg
+static QString real_or_data_hint() {
+    return QString(noo::names::hint_reallist) + " | data";
+}
+
 // Add points ==================================================================
 
 auto make_new_point_plot_method(Plotty& p) {
@@ -358,9 +569,13 @@ auto make_new_point_plot_method(Plotty& p) {
     m.method_name            = "new_point_plot";
     m.documentation          = "Create a new point plot";
     m.argument_documentation = {
-        { "xvals", "A list of point x values.", noo::names::hint_reallist },
-        { "yvals", "A list of point y values.", noo::names::hint_reallist },
-        { "zvals", "A list of point z values.", noo::names::hint_reallist },
+        { "xvals",
+          "A list of point x values. Can also be a byte string of "
+          "little-endian floats (float32, or an RFC 8746 typed array). If "
+          "yvals and zvals are null, this is a packed Nx3 array of x, y, z.",
+          real_or_data_hint() },
+        { "yvals", "A list of point y values.", real_or_data_hint() },
+        { "zvals", "A list of point z values.", real_or_data_hint() },
         { "colors",
           "An optional list of colors. Can be a 1D array of 3-stride floats "
           "for RGB, or a list of hex strings. Can be null to skip",
@@ -384,6 +599,8 @@ auto make_new_point_plot_method(Plotty& p) {
                     ColorListArgument   cols,
                     Scale3DListArgument scales,
                     noo::StringListArg  strings) -> QCborValue {
+        unpack_coordinates(xs, ys, zs);
+
         if (xs.list.size() != ys.list.size() or
             xs.list.size() != zs.list.size()) {
             throw noo::MethodException(
@@ -391,14 +608,16 @@ auto make_new_point_plot_method(Plotty& p) {
                 "Coordinate arrays must be the same length");
         }
 
-        return p.append<PointPlot>(
-            -1,
-            std::span(xs.list),
-            std::span(ys.list),
-            std::span(zs.list),
-            std::move(cols.colors),
-            scales.make_scale_vector(scales.scales, xs.list.size()),
-            std::move(strings.list));
+        auto scale_vector =
+            scales.make_scale_vector(scales.scales, xs.list.size());
+
+        return p.append<PointPlot>(-1,
+                                   std::move(xs.list),
+                                   std::move(ys.list),
+                                   std::move(zs.list),
+                                   std::move(cols.colors),
+                                   std::move(scale_vector),
+                                   std::move(strings.list));
     });
 
     return noo::create_method(p.document().get(), m);
@@ -413,23 +632,32 @@ auto make_new_line_segment_plot_method(Plotty& p) {
         "Create a new line segment plot. Points given are connected in pairs "
         "to create disconnected lines: a <-> b,  c <-> d";
     m.argument_documentation = {
-        { "xvals", "A list of point x values.", "reallist" },
-        { "yvals", "A list of point y values.", "reallist" },
-        { "zvals", "A list of point z values.", "reallist" },
+        { "xvals",
+          "A list of point x values. Can also be a byte string of "
+          "little-endian floats (float32, or an RFC 8746 typed array). If "
+          "yvals and zvals are null, this is a packed Nx3 array of x, y, z.",
+          real_or_data_hint() },
+        { "yvals", "A list of point y values.", real_or_data_hint() },
+        { "zvals", "A list of point z values.", real_or_data_hint() },
         { "colors",
           "A list of colors, one color for each point. Can be a 1D array of "
           "3-tuple floats for RGB, or a list of hex strings",
           "[string] | reallist" },
-        { "scales", "A list of 2D scales, laid out in a 1D array.", "reallist" }
+        { "scales",
+          "A list of 2D tube radii, laid out in a 1D array, one for each "
+          "segment. A single pair is used for every segment.",
+          "reallist" }
     };
     m.return_documentation = "An integer plot id";
 
     m.set_code([&p](noo::MethodContext const&,
-                    noo::RealListArg    xs,
-                    noo::RealListArg    ys,
-                    noo::RealListArg    zs,
+                    FloatListArg        xs,
+                    FloatListArg        ys,
+                    FloatListArg        zs,
                     ColorListArgument   cols,
                     Scale2DListArgument scales) -> QCborValue {
+        unpack_coordinates(xs, ys, zs);
+
         if (xs.list.size() != ys.list.size() or
             xs.list.size() != zs.list.size()) {
             throw noo::MethodException(
@@ -441,8 +669,62 @@ auto make_new_line_segment_plot_method(Plotty& p) {
                                          std::span(xs.list),
                                          std::span(ys.list),
                                          std::span(zs.list),
-                                         std::move(cols.colors),
-                                         std::move(scales.scales));
+                                         std::span(cols.colors),
+                                         std::span(scales.scales));
+    });
+
+    return noo::create_method(p.document().get(), m);
+}
+
+// Add polyline ================================================================
+
+auto make_new_polyline_plot_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name = "new_polyline_plot";
+    m.documentation =
+        "Create a new polyline plot. Points given are connected in order to "
+        "create a single line: a <-> b <-> c";
+    m.argument_documentation = {
+        { "xvals",
+          "A list of point x values. Can also be a byte string of "
+          "little-endian floats (float32, or an RFC 8746 typed array). If "
+          "yvals and zvals are null, this is a packed Nx3 array of x, y, z.",
+          real_or_data_hint() },
+        { "yvals", "A list of point y values.", real_or_data_hint() },
+        { "zvals", "A list of point z values.", real_or_data_hint() },
+        { "colors",
+          "A list of colors, one color for each point. A segment takes the "
+          "color of its first point. Can be a 1D array of 3-tuple floats for "
+          "RGB, or a list of hex strings",
+          "[string] | reallist" },
+        { "scales",
+          "A list of 2D tube radii, laid out in a 1D array, one for each "
+          "segment. A single pair is used for every segment.",
+          "reallist" }
+    };
+    m.return_documentation = "An integer plot id";
+
+    m.set_code([&p](noo::MethodContext const&,
+                    FloatListArg        xs,
+                    FloatListArg        ys,
+                    FloatListArg        zs,
+                    ColorListArgument   cols,
+                    Scale2DListArgument scales) -> QCborValue {
+        unpack_coordinates(xs, ys, zs);
+
+        if (xs.list.size() != ys.list.size() or
+            xs.list.size() != zs.list.size()) {
+            throw noo::MethodException(
+                noo::ErrorCodes::INVALID_PARAMS,
+                "Coordinate arrays must be the same length");
+        }
+
+        return p.append<PolylinePlot>(-1,
+                                      std::span(xs.list),
+                                      std::span(ys.list),
+                                      std::span(zs.list),
+                                      std::span(cols.colors),
+                                      std::span(scales.scales));
     });
 
     return noo::create_method(p.document().get(), m);
@@ -477,6 +759,373 @@ auto make_new_image_plot_method(Plotty& p) {
     return noo::create_method(p.document().get(), m);
 }
 
+// Add raw image ===============================================================
+
+// Far past any texture, but small enough that positions and sizes can be
+// added without overflowing an int
+constexpr int64_t max_image_side = int64_t(1) << 24;
+
+static int image_arg(int64_t value, int64_t lo, int64_t hi, char const* what) {
+    if (value < lo or value > hi) {
+        throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                   QString("%1 is out of range").arg(what));
+    }
+
+    return int(value);
+}
+
+auto make_new_raw_image_plot_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name = "new_raw_image_plot";
+    m.documentation =
+        "Create a new image plane from raw pixels. The image can be changed "
+        "later with update_image_region.";
+    m.argument_documentation = {
+        { "pixels",
+          "Row-major pixels, as bytes, or as little-endian float32 values "
+          "from 0 to 1.",
+          "data" },
+        { "width", "Width of the image in pixels", "integer" },
+        { "height", "Height of the image in pixels", "integer" },
+        { "channels", "1 for gray, 3 for RGB, or 4 for RGBA", "integer" },
+        { "top_left", "Point for the top-left of image plane", "reallist" },
+        { "bottom_left",
+          "Point for the bottom-left of image plane",
+          "reallist" },
+        { "bottom_right",
+          "Point for the bottom-right of image plane",
+          "reallist" }
+    };
+    m.return_documentation = "An integer plot id";
+
+    m.set_code([&](noo::MethodContext const&,
+                   QByteArray     pixels,
+                   int64_t        width,
+                   int64_t        height,
+                   int64_t        channels,
+                   ForceToGLMVec3 pa,
+                   ForceToGLMVec3 pb,
+                   ForceToGLMVec3 pc) {
+        auto image = image_from_pixels(
+            pixels,
+            image_arg(width, 1, max_image_side, "Width"),
+            image_arg(height, 1, max_image_side, "Height"),
+            image_arg(channels, 1, 4, "Channel count"));
+
+        if (image.isNull()) {
+            throw noo::MethodException(
+                noo::ErrorCodes::INVALID_PARAMS,
+                "Pixel data does not match the size and channels");
+        }
+
+        return p.append<ImagePlot>(-1, std::move(image), pa.v, pb.v, pc.v);
+    });
+
+    return noo::create_method(p.document().get(), m);
+}
+
+auto make_update_image_region_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name            = "update_image_region";
+    m.documentation          = "Replace part of an image made from raw pixels";
+    m.argument_documentation = {
+        { "plot_id", "The id of the image plot", "integer" },
+        { "pixels",
+          "Row-major pixels, as in new_raw_image_plot. Pixels past the edge "
+          "of the image are dropped.",
+          "data" },
+        { "x", "Left edge of the region, in pixels", "integer" },
+        { "y", "Top edge of the region, in pixels", "integer" },
+        { "width", "Width of the region in pixels", "integer" },
+        { "height", "Height of the region in pixels", "integer" },
+        { "channels", "1 for gray, 3 for RGB, or 4 for RGBA", "integer" },
+    };
+    m.return_documentation = "None";
+
+    m.set_code([&p](noo::MethodContext const&,
+                    int64_t    plot_id,
+                    QByteArray pixels,
+                    int64_t    x,
+                    int64_t    y,
+                    int64_t    width,
+                    int64_t    height,
+                    int64_t    channels) -> QCborValue {
+        auto* plot = dynamic_cast<ImagePlot*>(p.get_plot(plot_id));
+
+        if (!plot or !plot->is_raw()) {
+            throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                       "No raw image plot with that id");
+        }
+
+        auto const at =
+            QPoint(image_arg(x, -max_image_side, max_image_side, "X"),
+                   image_arg(y, -max_image_side, max_image_side, "Y"));
+
+        auto image = image_from_pixels(
+            pixels,
+            image_arg(width, 1, max_image_side, "Width"),
+            image_arg(height, 1, max_image_side, "Height"),
+            image_arg(channels, 1, 4, "Channel count"));
+
+        if (image.isNull()) {
+            throw noo::MethodException(
+                noo::ErrorCodes::INVALID_PARAMS,
+                "Pixel data does not match the size and channels");
+        }
+
+        plot->update_region(image, at);
+
+        return QCborValue {};
+    });
+
+    return noo::create_method(p.document().get(), m);
+}
+
+// Add tiled image =============================================================
+
+auto make_new_tiled_image_plot_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name = "new_tiled_image_plot";
+    m.documentation =
+        "Create a new image plane for very large images. The image is shown "
+        "as tiles, in more detail around the last selection or probe.";
+    m.argument_documentation = {
+        { "image", "Bytes of the on-disk image.", "data" },
+        { "top_left", "Point for the top-left of image plane", "reallist" },
+        { "bottom_left",
+          "Point for the bottom-left of image plane",
+          "reallist" },
+        { "bottom_right",
+          "Point for the bottom-right of image plane",
+          "reallist" }
+    };
+    m.return_documentation = "An integer plot id";
+
+    m.set_code([&](noo::MethodContext const&,
+                   QByteArray     data,
+                   ForceToGLMVec3 pa,
+                   ForceToGLMVec3 pb,
+                   ForceToGLMVec3 pc) {
+        return p.append<TiledImagePlot>(-1, data, pa.v, pb.v, pc.v);
+    });
+
+    return noo::create_method(p.document().get(), m);
+}
+
+// Glyph detail ================================================================
+
+auto make_set_glyph_detail_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name            = "set_glyph_detail";
+    m.documentation          = "Set the sphere detail of a point plot";
+    m.argument_documentation = {
+        { "plot_id", "The id of the point plot", "integer" },
+        { "detail",
+          "One of 'auto', 'icosphere', 'icosahedron', 'octahedron' or "
+          "'tetrahedron'. With 'auto', the detail is picked from the number "
+          "of points and the triangle budget.",
+          "text" },
+    };
+    m.return_documentation = "None";
+
+    m.set_code([&p](noo::MethodContext const&,
+                    int64_t plot_id,
+                    QString detail) -> QCborValue {
+        auto* plot = dynamic_cast<PointPlot*>(p.get_plot(plot_id));
+
+        if (!plot) {
+            throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                       "No point plot with that id");
+        }
+
+        static QHash<QString, GlyphType> const names = {
+            { "icosphere", GlyphType::Sphere },
+            { "icosahedron", GlyphType::Icosahedron },
+            { "octahedron", GlyphType::Octahedron },
+            { "tetrahedron", GlyphType::Tetrahedron },
+        };
+
+        if (detail == "auto") {
+            plot->set_glyph_detail(std::nullopt);
+            return QCborValue {};
+        }
+
+        auto iter = names.find(detail);
+
+        if (iter == names.end()) {
+            throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                       "Unknown glyph detail");
+        }
+
+        plot->set_glyph_detail(iter.value());
+
+        return QCborValue {};
+    });
+
+    return noo::create_method(p.document().get(), m);
+}
+
+// Render mode =================================================================
+
+auto make_set_render_mode_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name            = "set_render_mode";
+    m.documentation          = "Choose how a point plot draws its points";
+    m.argument_documentation = {
+        { "plot_id", "The id of the point plot", "integer" },
+        { "mode",
+          "'glyphs' for a scaled glyph per point, or 'points' for a single "
+          "mesh of colored points, which is much cheaper for large clouds.",
+          "text" },
+    };
+    m.return_documentation = "None";
+
+    m.set_code([&p](noo::MethodContext const&,
+                    int64_t plot_id,
+                    QString mode) -> QCborValue {
+        auto* plot = dynamic_cast<PointPlot*>(p.get_plot(plot_id));
+
+        if (!plot) {
+            throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                       "No point plot with that id");
+        }
+
+        if (mode == "glyphs") {
+            plot->set_render_mode(RenderMode::Glyphs);
+        } else if (mode == "points") {
+            plot->set_render_mode(RenderMode::Points);
+        } else {
+            throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                       "Unknown render mode");
+        }
+
+        return QCborValue {};
+    });
+
+    return noo::create_method(p.document().get(), m);
+}
+
+// Line style ==================================================================
+
+auto make_set_line_style_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name            = "set_line_style";
+    m.documentation          = "Choose how a segment or polyline plot is drawn";
+    m.argument_documentation = {
+        { "plot_id", "The id of the segment or polyline plot", "integer" },
+        { "style",
+          "'tubes' for a scaled tube per segment, 'lines' for a single line "
+          "mesh, which is much cheaper for large plots, or 'auto' to use "
+          "lines above the line threshold.",
+          "text" },
+    };
+    m.return_documentation = "None";
+
+    m.set_code([&p](noo::MethodContext const&,
+                    int64_t plot_id,
+                    QString style) -> QCborValue {
+        auto* plot = dynamic_cast<SegmentPlot*>(p.get_plot(plot_id));
+
+        if (!plot) {
+            throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                       "No segment plot with that id");
+        }
+
+        if (style == "auto") {
+            plot->set_style(std::nullopt);
+        } else if (style == "tubes") {
+            plot->set_style(SegmentStyle::Tubes);
+        } else if (style == "lines") {
+            plot->set_style(SegmentStyle::Lines);
+        } else {
+            throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                       "Unknown line style");
+        }
+
+        return QCborValue {};
+    });
+
+    return noo::create_method(p.document().get(), m);
+}
+
+// Vertex budget ===============================================================
+
+auto make_set_vertex_budget_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name   = "set_vertex_budget";
+    m.documentation = "Limit the number of vertices drawn for a polyline plot";
+    m.argument_documentation = {
+        { "plot_id", "The id of the polyline plot", "integer" },
+        { "budget",
+          "The most vertices to draw. Longer lines are decimated, keeping "
+          "more detail in the last selected or probed region. 0 for no "
+          "limit.",
+          "integer" },
+    };
+    m.return_documentation = "None";
+
+    m.set_code([&p](noo::MethodContext const&,
+                    int64_t plot_id,
+                    int64_t budget) -> QCborValue {
+        auto* plot = dynamic_cast<SegmentPlot*>(p.get_plot(plot_id));
+
+        if (!plot) {
+            throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                       "No segment plot with that id");
+        }
+
+        if (budget < 0) {
+            throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                       "Budget must not be negative");
+        }
+
+        plot->set_vertex_budget(size_t(budget));
+
+        return QCborValue {};
+    });
+
+    return noo::create_method(p.document().get(), m);
+}
+
+// Delete plots ================================================================
+
+auto make_delete_plot_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name   = "delete_plot";
+    m.documentation = "Remove a plot, and release everything it holds";
+    m.argument_documentation = {
+        { "plot_id", "The id of the plot", "integer" },
+    };
+    m.return_documentation = "None";
+
+    m.set_code(
+        [&p](noo::MethodContext const&, int64_t plot_id) -> QCborValue {
+            if (!p.delete_plot(plot_id)) {
+                throw noo::MethodException(noo::ErrorCodes::INVALID_PARAMS,
+                                           "No plot with that id");
+            }
+
+            return QCborValue {};
+        });
+
+    return noo::create_method(p.document().get(), m);
+}
+
+auto make_clear_plots_method(Plotty& p) {
+    noo::MethodData m;
+    m.method_name            = "clear_plots";
+    m.documentation          = "Remove every plot";
+    m.argument_documentation = {};
+    m.return_documentation   = "None";
+
+    m.set_code([&p](noo::MethodContext const&) -> QCborValue {
+        p.clear_plots();
+        return QCborValue {};
+    });
+
+    return noo::create_method(p.document().get(), m);
+}
+
 // Update Table ================================================================
 
 // auto make_update_table_method(Plotty& p) {
@@ -560,21 +1209,38 @@ auto make_new_image_plot_method(Plotty& p) {
 
 // Add Plotty ==================================================================
 
-Plotty::Plotty(uint16_t port) {
+Plotty::Plotty(PlottyOptions const& options) : m_options(options) {
     m_shared_domain = new SharedDomain(this);
 
+    if (m_options.use_asset_server) {
+        m_asset_server = new AssetServer(
+            m_options.asset_host, m_options.asset_port, this);
+
+        if (!m_asset_server->is_listening()) {
+            delete m_asset_server;
+            m_asset_server = nullptr;
+        }
+    }
+
     connect(m_shared_domain,
             &SharedDomain::domain_updated,
             this,
             &Plotty::on_domain_updated);
 
-    noo::ServerOptions options {
-        .port = port,
+    m_frame_timer = new QTimer(this);
+    m_frame_timer->setInterval(std::max(m_options.frame_interval, 0));
+
+    connect(m_frame_timer, &QTimer::timeout, this, &Plotty::on_frame);
+
+    m_outbound_clock.start();
+
+    noo::ServerOptions server_options {
+        .port = m_options.port,
     };
 
-    m_server = noo::create_server(options);
+    m_server = noo::create_server(server_options);
 
-    qInfo() << "Creating server, listening on port" << port;
+    qInfo() << "Creating server, listening on port" << m_options.port;
 
     Q_ASSERT(m_server);
 
@@ -582,6 +1248,9 @@ Plotty::Plotty(uint16_t port) {
 
     Q_ASSERT(m_doc);
 
+    m_glyphs = std::make_unique<GlyphRegistry>(m_doc);
+    m_glyphs->set_domain_scale(m_shared_domain->current_domain().scale());
+
     noo::DocumentData docup;
 
     {
@@ -597,12 +1266,42 @@ Plotty::Plotty(uint16_t port) {
         ptr = make_new_line_segment_plot_method(*this);
         methods.push_back(ptr);
 
+        ptr = make_new_polyline_plot_method(*this);
+        methods.push_back(ptr);
+
         ptr = make_new_image_plot_method(*this);
         methods.push_back(ptr);
 
+        ptr = make_new_tiled_image_plot_method(*this);
+        methods.push_back(ptr);
+
+        ptr = make_new_raw_image_plot_method(*this);
+        methods.push_back(ptr);
+
+        ptr = make_update_image_region_method(*this);
+        methods.push_back(ptr);
+
         ptr = make_set_domain_method(*this);
         methods.push_back(ptr);
 
+        ptr = make_set_glyph_detail_method(*this);
+        methods.push_back(ptr);
+
+        ptr = make_set_render_mode_method(*this);
+        methods.push_back(ptr);
+
+        ptr = make_set_line_style_method(*this);
+        methods.push_back(ptr);
+
+        ptr = make_set_vertex_budget_method(*this);
+        methods.push_back(ptr);
+
+        ptr = make_delete_plot_method(*this);
+        methods.push_back(ptr);
+
+        ptr = make_clear_plots_method(*this);
+        methods.push_back(ptr);
+
         //        ptr = make_update_table_method(*this);
         //        docup.method_list.push_back(ptr);
 
@@ -624,6 +1323,17 @@ Plotty::Plotty(uint16_t port) {
         m_plot_root = noo::create_object(m_doc, nd);
     }
 
+    {
+        noo::ObjectData nd;
+
+        nd.name      = "Data Root";
+        nd.parent    = m_plot_root;
+        nd.transform = m_shared_domain->current_domain().matrix();
+        nd.tags      = QStringList() << noo::names::tag_user_hidden;
+
+        m_data_root = noo::create_object(m_doc, nd);
+    }
+
     auto add_light = [this](glm::vec3 p, QColor color, float i) {
         auto& nl = m_lights.emplace_back();
 
@@ -659,10 +1369,75 @@ std::shared_ptr<noo::DocumentT> Plotty::document() {
     return m_doc;
 }
 
+Plotty::PublishedBuffer Plotty::create_buffer(QByteArray data) {
+    PublishedBuffer ret;
+
+    if (m_asset_server and data.size() >= m_options.asset_threshold) {
+        auto const size = uint64_t(data.size());
+
+        ret.asset  = m_asset_server->publish(std::move(data));
+        ret.buffer = noo::create_buffer(
+            m_doc,
+            noo::BufferData {
+                .source =
+                    noo::BufferURISource {
+                        .url_source       = ret.asset->url(),
+                        .source_byte_size = size,
+                    },
+            });
+
+        return ret;
+    }
+
+    note_outbound(data.size());
+
+    ret.buffer = noo::create_buffer(
+        m_doc,
+        noo::BufferData {
+            .source = noo::BufferInlineSource { .data = data },
+        });
+
+    return ret;
+}
+
+void Plotty::schedule_flush(int64_t plot_id) {
+    m_dirty_plots.insert(plot_id);
+
+    // the timer only runs while something is waiting
+    if (!m_frame_timer->isActive()) m_frame_timer->start();
+}
+
+void Plotty::drain_outbound() {
+    auto const seconds = double(m_outbound_clock.restart()) / 1000.0;
+    auto const drained = seconds * double(m_options.rate_limit);
+
+    m_outbound_bytes = std::max(0.0, m_outbound_bytes - drained);
+}
+
+void Plotty::note_outbound(qsizetype bytes) {
+    drain_outbound();
+    m_outbound_bytes += double(bytes);
+}
+
+bool Plotty::rate_limited() {
+    if (m_options.rate_limit == 0) return false;
+
+    drain_outbound();
+    return m_outbound_bytes > double(m_options.rate_limit_burst);
+}
+
+GlyphRegistry& Plotty::glyphs() {
+    return *m_glyphs;
+}
+
 noo::ObjectTPtr Plotty::plot_root() {
     return m_plot_root;
 }
 
+noo::ObjectTPtr Plotty::data_root() {
+    return m_data_root;
+}
+
 SharedDomain* Plotty::domain() const {
     return m_shared_domain;
 }
@@ -685,8 +1460,116 @@ Plot* Plotty::get_plot(size_t i) {
     return iter->second.get();
 }
 
+bool Plotty::delete_plot(int64_t plot_id) {
+    auto iter = m_plots.find(plot_id);
+
+    if (iter == m_plots.end()) return false;
+
+    // the plot drops its objects, meshes, buffers and table as it goes
+    m_plots.erase(iter);
+
+    auto owned = m_plot_objects.extract(plot_id);
+
+    if (owned) {
+        for (auto key : owned.mapped().keys) {
+            auto entry = m_object_plots.find(key);
+
+            // the address may have gone to another plot since
+            if (entry == m_object_plots.end()) continue;
+            if (entry->second.plot_id != plot_id) continue;
+
+            m_object_plots.erase(entry);
+        }
+    }
+
+    m_dirty_plots.erase(plot_id);
+
+    return true;
+}
+
+void Plotty::clear_plots() {
+    m_plots.clear();
+    m_object_plots.clear();
+    m_plot_objects.clear();
+    m_dirty_plots.clear();
+}
+
+void Plotty::register_object(noo::ObjectTPtr const& obj, int64_t plot_id) {
+    if (!obj) return;
+
+    m_object_plots[obj.get()] = { obj, plot_id };
+
+    auto& owned = m_plot_objects[plot_id];
+
+    owned.keys.push_back(obj.get());
+
+    // parts of a plot come and go; sweep out the dead ones whenever the
+    // list has doubled since the last sweep
+    if (owned.keys.size() >= 2 * owned.swept) sweep_objects(plot_id, owned);
+}
+
+void Plotty::sweep_objects(int64_t plot_id, PlotObjects& owned) {
+    auto& keys = owned.keys;
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::erase_if(keys, [this, plot_id](noo::ObjectT const* key) {
+        auto entry = m_object_plots.find(key);
+
+        if (entry == m_object_plots.end()) return true;
+
+        // taken over by another plot, which keeps its own key
+        if (entry->second.plot_id != plot_id) return true;
+
+        if (!entry->second.object.expired()) return false;
+
+        m_object_plots.erase(entry);
+        return true;
+    });
+
+    owned.swept = std::max<size_t>(keys.size(), 16);
+}
+
+int64_t Plotty::plot_id_of(noo::ObjectTPtr const& obj) const {
+    if (!obj) return -1;
+
+    auto iter = m_object_plots.find(obj.get());
+
+    if (iter == m_object_plots.end()) return -1;
+
+    // the address may since have been taken by an object we do not know
+    if (iter->second.object.lock() != obj) return -1;
+
+    return iter->second.plot_id;
+}
+
+void Plotty::on_frame() {
+    // plots keep merging changes until we are back under the limit
+    if (rate_limited()) return;
+
+    auto dirty = std::exchange(m_dirty_plots, {});
+
+    for (auto id : dirty) {
+        // the plot may have been removed since it asked
+        if (auto* plot = get_plot(id)) plot->flush();
+    }
+
+    if (m_dirty_plots.empty()) m_frame_timer->stop();
+}
+
 void Plotty::on_domain_updated() {
     make_box();
+
+    // plots live in data space under this, so moving the domain is just this
+    // one update
+    noo::ObjectUpdateData update;
+    update.transform = m_shared_domain->current_domain().matrix();
+
+    noo::update_object(m_data_root, update);
+
+    // glyph plots pick up meshes for the new scale when they next flush
+    m_glyphs->set_domain_scale(m_shared_domain->current_domain().scale());
 }
 
 void Plotty::on_domain_labels_updated() {
@@ -3,12 +3,60 @@
 
 #include <noo_server_interface.h>
 
+#include <QElapsedTimer>
+
+#include <limits>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 struct TableStorage;
 
 class Plot;
+class Asset;
+class AssetServer;
+class GlyphRegistry;
+
+class QTimer;
+
+///
+/// \brief An axis aligned box, grown a point at a time. Default constructed
+/// boxes are empty.
+///
+struct Bounds {
+    glm::vec3 lo = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 hi = glm::vec3(std::numeric_limits<float>::lowest());
+
+    bool empty() const { return glm::any(glm::greaterThan(lo, hi)); }
+
+    void extend(glm::vec3 p) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+
+    void extend(Bounds const& o) {
+        lo = glm::min(lo, o.lo);
+        hi = glm::max(hi, o.hi);
+    }
+
+    bool contains(glm::vec3 p) const {
+        return glm::all(glm::greaterThanEqual(p, lo)) and
+               glm::all(glm::lessThanEqual(p, hi));
+    }
+
+    bool intersects(Bounds const& o) const {
+        return !glm::any(glm::greaterThan(lo, o.hi)) and
+               !glm::any(glm::lessThan(hi, o.lo));
+    }
+
+    /// \brief If the point defines part of the box, so that removing it may
+    /// shrink the box.
+    bool on_boundary(glm::vec3 p) const {
+        return glm::any(glm::equal(p, lo)) or glm::any(glm::equal(p, hi));
+    }
+
+    bool operator==(Bounds const&) const = default;
+};
 
 struct Domain {
     glm::vec3 input_min = glm::vec3(-.5);
@@ -20,6 +68,18 @@ struct Domain {
 
     /// \brief transform an input coordinate to an output coordinate
     glm::vec3 transform(glm::vec3) const;
+
+    /// \brief transform an output coordinate back to an input coordinate
+    glm::vec3 inverse_transform(glm::vec3) const;
+
+    /// \brief the per-axis scale from input to output space
+    glm::vec3 scale() const;
+
+    /// \brief the per-axis translation applied after scaling
+    glm::vec3 offset() const;
+
+    /// \brief the transform as a matrix
+    glm::mat4 matrix() const;
 };
 
 // =============================================================================
@@ -29,6 +89,13 @@ class SharedDomain : public QObject {
     Domain m_current_domain;
     bool   m_domain_auto = true;
 
+    // bounds reported by each plot, and their union
+    std::unordered_map<int64_t, Bounds> m_plot_bounds;
+    Bounds                              m_union_bounds;
+
+    void recompute_union();
+    void apply_input_bounds(glm::vec3, glm::vec3);
+
 
     QString m_x_axis_title = "x";
     QString m_y_axis_title = "y";
@@ -44,7 +111,16 @@ public:
 
     void ask_set_domain(Domain d);
 
-    void ask_update_input_bounds(glm::vec3, glm::vec3);
+    ///
+    /// \brief Set the data bounds of a plot.
+    ///
+    /// The input domain follows the union of all plot bounds while auto updates
+    /// are on. The domain is only updated if the union changes.
+    ///
+    void update_plot_bounds(int64_t plot_id, Bounds const&);
+
+    /// \brief Forget the bounds of a plot, say when it is deleted.
+    void remove_plot_bounds(int64_t plot_id);
 
     void set_axis_labels(QString x_axis_title,
                          QString y_axis_title,
@@ -61,6 +137,48 @@ signals:
 
 // =============================================================================
 
+struct PlottyOptions {
+    uint16_t port = 50000;
+
+    // Buffers of at least asset_threshold bytes are served over HTTP, instead
+    // of being sent inline over the websocket
+    bool      use_asset_server = false;
+    QString   asset_host       = "localhost";
+    uint16_t  asset_port       = 50001;
+    qsizetype asset_threshold  = 1 << 20;
+
+    // point plots pick coarser spheres to stay under this many triangles
+    size_t triangle_budget = 10'000'000;
+
+    // segment plots with more segments than this draw as lines, not tubes
+    size_t line_threshold = 1'000'000;
+
+    // polylines with more vertices than this are decimated; 0 for no limit
+    size_t vertex_budget = 1'000'000;
+
+    // images are shrunk to fit in a square this many pixels wide
+    int max_texture_size = 4096;
+
+    // tiled images are cut into tiles this many pixels wide, and drop unused
+    // tiles past the memory budget
+    int    tile_size          = 512;
+    size_t tile_memory_budget = size_t(256) << 20;
+
+    static constexpr int min_tile_size = 16;
+    static constexpr int max_tile_size = 8192;
+
+    // plot changes are collected and sent at most once per frame, in ms
+    int frame_interval = 16;
+
+    // An optional limit on the bytes a second sent inline to clients, with
+    // room for bursts of up to rate_limit_burst bytes. Frames are held while
+    // over the limit. noodles does not show how much is queued for each
+    // client, so this is a fixed rate, not a measure of slow clients. 0 for
+    // no limit.
+    size_t rate_limit       = 0;
+    size_t rate_limit_burst = size_t(64) << 20;
+};
+
 struct LightObj {
     noo::ObjectTPtr o;
     noo::LightTPtr  l;
@@ -72,15 +190,24 @@ class Plotty : public QObject {
     // Domain
     SharedDomain* m_shared_domain = nullptr;
 
+    PlottyOptions m_options;
+
     // Noodles stuff
     noo::ServerTPtr m_server;
 
+    AssetServer* m_asset_server = nullptr;
+
     noo::DocumentTPtr m_doc;
 
+    std::unique_ptr<GlyphRegistry> m_glyphs;
+
     std::vector<LightObj> m_lights;
 
     noo::ObjectTPtr m_plot_root;
 
+    // child of the plot root, carrying the domain transform
+    noo::ObjectTPtr m_data_root;
+
     int64_t m_plot_counter = 1; // 0 is reserved for immediate plot
 
     noo::MeshTPtr     m_box_mesh;
@@ -96,9 +223,38 @@ class Plotty : public QObject {
     // Plots
     std::unordered_map<size_t, std::unique_ptr<Plot>> m_plots;
 
+    // the plot each object belongs to, keyed by address; the weak pointer
+    // tells a live entry from one whose object is gone
+    struct ObjectEntry {
+        std::weak_ptr<noo::ObjectT> object;
+        int64_t                     plot_id;
+    };
+
+    std::unordered_map<noo::ObjectT const*, ObjectEntry> m_object_plots;
+
+    // the keys each plot has registered, so a plot can be dropped from the
+    // index without a full scan. Dead keys are swept once the list doubles.
+    struct PlotObjects {
+        std::vector<noo::ObjectT const*> keys;
+        size_t                           swept = 16;
+    };
+
+    std::unordered_map<int64_t, PlotObjects> m_plot_objects;
+
+    void sweep_objects(int64_t plot_id, PlotObjects&);
+
+    // Frames
+    std::unordered_set<int64_t> m_dirty_plots;
+    QTimer*                     m_frame_timer = nullptr;
+
+    // bytes sent past the rate limit, as of the clock
+    double        m_outbound_bytes = 0;
+    QElapsedTimer m_outbound_clock;
+
+    void drain_outbound();
 
 public:
-    Plotty(uint16_t port);
+    Plotty(PlottyOptions const& options);
 
     ~Plotty();
 
@@ -106,10 +262,51 @@ public:
 
     noo::ObjectTPtr plot_root();
 
+    /// \brief The parent for plot content, which is given in data space.
+    noo::ObjectTPtr data_root();
+
     SharedDomain* domain() const;
 
+    PlottyOptions const& options() const { return m_options; }
+
+    /// \brief Glyph meshes shared by all plots
+    GlyphRegistry& glyphs();
+
     auto const& all_plots() const { return m_plots; }
 
+    struct PublishedBuffer {
+        noo::BufferTPtr        buffer;
+        std::shared_ptr<Asset> asset; // keep this as long as the buffer
+    };
+
+    ///
+    /// \brief Create a buffer holding data.
+    ///
+    /// Large buffers are published on the asset server, if it is enabled, and
+    /// referenced by URL. Otherwise the data is sent inline.
+    ///
+    PublishedBuffer create_buffer(QByteArray data);
+
+    ///
+    /// \brief Ask for a plot to be flushed on the next frame.
+    ///
+    /// Plots collect changes as they come in, and apply them all at once when
+    /// flushed. Frames are at least the frame interval apart, and are put off
+    /// while over the rate limit.
+    ///
+    void schedule_flush(int64_t plot_id);
+
+    ///
+    /// \brief Count bytes sent to clients over the websocket.
+    ///
+    /// noodles sends mesh data inline without telling us, so plots that
+    /// build large meshes should report their size here.
+    ///
+    void note_outbound(qsizetype bytes);
+
+    /// \brief If updates have run more than a burst past the rate limit
+    bool rate_limited();
+
 public:
     ///
     /// \brief Append a new plot to the scene
@@ -138,10 +335,27 @@ public:
 
     Plot* get_plot(size_t);
 
+    ///
+    /// \brief Remove a plot, releasing its document resources and data.
+    ///
+    /// \returns false if there is no such plot
+    ///
+    bool delete_plot(int64_t plot_id);
+
+    /// \brief Remove every plot
+    void clear_plots();
+
+    /// \brief Record the plot an object belongs to, for plot_id_of
+    void register_object(noo::ObjectTPtr const&, int64_t plot_id);
+
+    /// \brief The plot an object belongs to, or -1 if none
+    int64_t plot_id_of(noo::ObjectTPtr const&) const;
+
     auto begin() { return m_plots.begin(); }
     auto end() { return m_plots.end(); }
 
 private slots:
+    void on_frame();
     void on_domain_updated();
     void on_domain_labels_updated();
 };
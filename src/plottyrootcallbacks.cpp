@@ -2,6 +2,7 @@
 
 #include "plot.h"
 #include "plotty.h"
+#include "taskpool.h"
 
 #include <QDebug>
 
@@ -12,6 +13,34 @@ static noo::EntityCallbacks::EnableCallback flags = {
     .probing   = true,
 };
 
+void PlottyRootCallbacks::select_all(SpatialSelection const& sel) {
+    // Work out the hits for every plot in parallel, and then apply them here;
+    // applying touches tables and the document.
+
+    std::vector<Plot*> plots;
+
+    for (auto& [k, v] : *m_plotty) {
+        plots.push_back(v.get());
+    }
+
+    for (auto* plot : plots) {
+        plot->prepare_queries();
+    }
+
+    std::vector<std::function<void()>> applies(plots.size());
+
+    TaskPool::global().parallel_for(
+        0, plots.size(), 1, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++) {
+                applies[i] = plots[i]->prepare_selection(sel);
+            }
+        });
+
+    for (auto& apply : applies) {
+        if (apply) apply();
+    }
+}
+
 PlottyRootCallbacks::PlottyRootCallbacks(Plotty* plotty, noo::ObjectT* t)
     : noo::EntityCallbacks(t, flags), m_plotty(plotty) {
     qDebug() << Q_FUNC_INFO << this;
@@ -24,9 +53,7 @@ void PlottyRootCallbacks::select_region(glm::vec3 min,
     SpatialSelection sel =
         SelectRegion { .min = min, .max = max, .select = (int)select };
 
-    for (auto& [k, v] : *m_plotty) {
-        v->handle_selection(sel);
-    }
+    select_all(sel);
 }
 
 void PlottyRootCallbacks::select_sphere(glm::vec3 point,
@@ -36,9 +63,7 @@ void PlottyRootCallbacks::select_sphere(glm::vec3 point,
     SpatialSelection sel = SelectSphere { .point  = point,
                                           .radius = distance,
                                           .select = (int)select };
-    for (auto& [k, v] : *m_plotty) {
-        v->handle_selection(sel);
-    }
+    select_all(sel);
 }
 
 void PlottyRootCallbacks::select_plane(glm::vec3 point,
@@ -47,9 +72,7 @@ void PlottyRootCallbacks::select_plane(glm::vec3 point,
 
     SpatialSelection sel =
         SelectPlane { .point = point, .normal = normal, .select = (int)select };
-    for (auto& [k, v] : *m_plotty) {
-        v->handle_selection(sel);
-    }
+    select_all(sel);
 }
 
 void PlottyRootCallbacks::select_hull(std::span<glm::vec3 const> hull,
@@ -58,9 +81,7 @@ void PlottyRootCallbacks::select_hull(std::span<glm::vec3 const> hull,
 
     SpatialSelection sel =
         SelectHull { .points = hull, .index = index, .select = (int)select };
-    for (auto& [k, v] : *m_plotty) {
-        v->handle_selection(sel);
-    }
+    select_all(sel);
 }
 
 
@@ -72,13 +93,31 @@ std::pair<QString, glm::vec3> PlottyRootCallbacks::probe_at(glm::vec3 p) {
     glm::vec3 place;
     int       place_count = 0;
 
+    std::vector<std::pair<size_t, Plot*>> plots;
+
     for (auto& [k, v] : *m_plotty) {
+        plots.emplace_back(k, v.get());
+    }
+
+    for (auto& [id, plot] : plots) {
+        plot->prepare_queries();
+    }
+
+    std::vector<Plot::ProbeResult> results(plots.size());
+
+    TaskPool::global().parallel_for(
+        0, plots.size(), 1, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++) {
+                results[i] = plots[i].second->handle_probe(p);
+            }
+        });
 
-        auto result = v->handle_probe(p);
+    for (size_t i = 0; i < plots.size(); i++) {
+        auto const& result = results[i];
 
         if (result.text.isEmpty()) continue;
 
-        ss += QString("Plt %1: %2\n").arg(k).arg(result.text);
+        ss += QString("Plt %1: %2\n").arg(plots[i].first).arg(result.text);
 
         if (result.place) {
             if (place_count > 0) {
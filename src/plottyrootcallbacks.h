@@ -4,10 +4,13 @@
 #include "noo_server_interface.h"
 
 class Plotty;
+struct SpatialSelection;
 
 class PlottyRootCallbacks : public noo::EntityCallbacks {
     Plotty* m_plotty;
 
+    void select_all(SpatialSelection const&);
+
 public:
     PlottyRootCallbacks(Plotty* plotty, noo::ObjectT*);
 
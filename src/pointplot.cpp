@@ -9,111 +9,295 @@
 
 #include <QDebug>
 
+#include <algorithm>
+#include <utility>
+
 enum { PX, PY, PZ, CR, CG, CB, SX, SY, SZ, ANNO };
 
+ScatterCore::ArrayRef PointPlot::instance_source() const {
+    return {
+        .px = m_data_source.column<PX>(),
+        .py = m_data_source.column<PY>(),
+        .pz = m_data_source.column<PZ>(),
+
+        .cr = m_data_source.column<CR>(),
+        .cg = m_data_source.column<CG>(),
+        .cb = m_data_source.column<CB>(),
+
+        .sx = m_data_source.column<SX>(),
+        .sy = m_data_source.column<SY>(),
+        .sz = m_data_source.column<SZ>(),
+    };
+}
+
+namespace {
+
+// Columns for a background build. The copies share storage with the table
+// until it next writes.
+struct ColumnSnapshot {
+    QVector<float> px, py, pz;
+    QVector<float> cr, cg, cb;
+    QVector<float> sx, sy, sz;
+
+    static std::span<float const> view(QVector<float> const& v) {
+        return { v.constData(), size_t(v.size()) };
+    }
+
+    ScatterCore::ArrayRef ref() const {
+        return {
+            .px = view(px),
+            .py = view(py),
+            .pz = view(pz),
+
+            .cr = view(cr),
+            .cg = view(cg),
+            .cb = view(cb),
+
+            .sx = view(sx),
+            .sy = view(sy),
+            .sz = view(sz),
+        };
+    }
+};
+
+} // namespace
+
 void PointPlot::rebuild_instances() {
-    auto d = m_host->domain()->current_domain();
+    // rows written from here on are applied on top of the result
+    m_rows_behind.clear();
 
-    auto px = m_data_source.column<PX>();
-    auto py = m_data_source.column<PY>();
-    auto pz = m_data_source.column<PZ>();
+    auto const& cols = m_data_source.table().columns();
 
-    m_scatter_instances.build_instances(
-        {
-            .px = px,
-            .py = py,
-            .pz = pz,
+    ColumnSnapshot snapshot {
+        .px = std::get<PX>(cols),
+        .py = std::get<PY>(cols),
+        .pz = std::get<PZ>(cols),
 
-            .cr = m_data_source.column<CR>(),
-            .cg = m_data_source.column<CG>(),
-            .cb = m_data_source.column<CB>(),
+        .cr = std::get<CR>(cols),
+        .cg = std::get<CG>(cols),
+        .cb = std::get<CB>(cols),
+
+        .sx = std::get<SX>(cols),
+        .sy = std::get<SY>(cols),
+        .sz = std::get<SZ>(cols),
+    };
 
-            .sx = m_data_source.column<SX>(),
-            .sy = m_data_source.column<SY>(),
-            .sz = m_data_source.column<SZ>(),
+    start_rebuild(
+        [snapshot = std::move(snapshot)](std::stop_token stop) {
+            InstanceArena out;
+            ScatterCore::build_all(snapshot.ref(), out, stop);
+            return out;
         },
-        d);
+        [this](InstanceArena out) {
+            m_scatter_instances.adopt(std::move(out));
 
-    update_instances(
-        m_scatter_instances.instances(), m_host->document(), m_obj, m_mesh);
+            // this also follows the table if it grew or shrank since
+            auto behind = std::exchange(m_rows_behind, {});
 
-    auto* sd = m_host->domain();
+            m_scatter_instances.update_rows(instance_source(), behind);
 
-    if (px.size() and sd->domain_auto_updates()) {
-        auto [l, h] = min_max_of(px, py, pz);
-        m_host->domain()->ask_update_input_bounds(l, h);
+            m_pages.update(m_scatter_instances.instances(),
+                           m_scatter_instances.take_dirty());
+        });
+}
+
+void PointPlot::rebuild_rows(std::span<RowRange const> rows) {
+    // the full rebuild catches up on these when it lands
+    if (rebuild_running()) {
+        m_rows_behind.insert(m_rows_behind.end(), rows.begin(), rows.end());
+        return;
     }
+
+    m_scatter_instances.update_rows(instance_source(), rows);
+
+    m_pages.update(m_scatter_instances.instances(),
+                   m_scatter_instances.take_dirty());
 }
 
-const QString brush_selection_name = "brushed";
+void PointPlot::rebuild_point_cloud() {
+    std::vector<glm::vec3>   positions;
+    std::vector<glm::u8vec4> colors;
 
-template <class DS, class Function>
-std::vector<int64_t> build_select_keys(DS const& source, Function&& function) {
-    std::vector<int64_t> keys;
+    ScatterCore::build_points(instance_source(), positions, colors);
 
-    auto const& t = source.table();
+    if (positions.empty()) {
+        m_point_obj.reset();
+        m_point_mesh.reset();
+        return;
+    }
 
-    auto all_keys = t.get_all_keys();
+    noo::MeshSource mesh_data;
+    mesh_data.material  = m_mat;
+    mesh_data.positions = positions;
+    mesh_data.colors    = colors;
+    mesh_data.type      = noo::MeshSource::POINT;
+
+    show_mesh_part(mesh_data,
+                   positions.size() * sizeof(glm::vec3) +
+                       colors.size() * sizeof(glm::u8vec4),
+                   QString("Points %1").arg(m_plot_id),
+                   m_point_mesh,
+                   m_point_obj);
+}
 
-    // auto const& map = source.table().get_row_to_key_map();
+void PointPlot::set_render_mode(RenderMode mode) {
+    if (mode == m_render_mode) return;
 
-    // auto const& inst = instances.instances();
+    m_render_mode = mode;
 
-    for (int key : all_keys) {
+    if (mode == RenderMode::Points) {
+        cancel_rebuild();
+        m_rows_behind.clear();
 
+        // drops every page
+        m_scatter_instances.clear();
+        m_pages.update(m_scatter_instances.instances(), {});
+
+        rebuild_point_cloud();
+        return;
+    }
 
-        auto p = glm::vec3(t.template get_column_at_key<PX>(key),
-                           t.template get_column_at_key<PY>(key),
-                           t.template get_column_at_key<PZ>(key));
+    m_point_obj.reset();
+    m_point_mesh.reset();
 
-        if (function(p)) { keys.push_back(key); }
+    // the domain may have moved on while we drew points
+    update_glyph();
+    rebuild_instances();
+}
+
+void PointPlot::publish_bounds() {
+    if (m_bounds_dirty) {
+        auto px = m_data_source.column<PX>();
+
+        m_bounds = Bounds();
+
+        if (px.size()) {
+            auto [l, h] = min_max_of(
+                px, m_data_source.column<PY>(), m_data_source.column<PZ>());
+            m_bounds = { l, h };
+        }
+
+        m_bounds_dirty = false;
     }
 
-    return keys;
+    m_host->domain()->update_plot_bounds(m_plot_id, m_bounds);
 }
 
-void PointPlot::select(SelectRegion const& sel) {
+GlyphType PointPlot::wanted_glyph() const {
+    if (m_glyph_override) return *m_glyph_override;
 
-    std::vector<int64_t> keys =
-        build_select_keys(m_data_source, [&sel](glm::vec3 const& p) {
-            if (!glm::all(glm::greaterThanEqual(p, sel.min))) return false;
-            if (!glm::all(glm::lessThanEqual(p, sel.max))) return false;
-            return true;
-        });
+    return sphere_for_budget(m_data_source.column<PX>().size(),
+                             m_host->options().triangle_budget);
+}
 
-    m_data_source.table().modify_selection(
-        brush_selection_name, keys, sel.select);
+void PointPlot::update_glyph() {
+    auto wanted = wanted_glyph();
+    auto glyph  = m_host->glyphs().get(wanted);
+
+    if (glyph.mesh == m_mesh) return;
+
+    m_glyph_type = wanted;
+    m_mat        = glyph.material;
+    m_mesh       = glyph.mesh;
+
+    m_pages.set_mesh(m_mesh);
 }
 
-void PointPlot::select(SelectSphere const& sel) {
+void PointPlot::set_glyph_detail(std::optional<GlyphType> type) {
+    m_glyph_override = type;
+    update_glyph();
+}
 
-    auto radius_sq = sel.radius * sel.radius;
+void PointPlot::data_updated(std::span<RowRange const> rows) {
+    if (m_render_mode == RenderMode::Points) {
+        publish_bounds();
+        rebuild_point_cloud();
+        return;
+    }
 
-    auto test = [&sel, radius_sq](glm::vec3 const& p) {
-        auto to_p = p - sel.point;
-        auto d    = glm::dot(to_p, to_p);
-        return radius_sq < d;
-    };
+    update_glyph();
 
-    std::vector<int64_t> keys = build_select_keys(m_data_source, test);
+    publish_bounds();
 
-    m_data_source.table().modify_selection(
-        brush_selection_name, keys, sel.select);
+    rebuild_rows(rows);
 }
 
-void PointPlot::select(SelectPlane const& sel) {
-    auto n = glm::normalize(sel.normal);
+const QString brush_selection_name = "brushed";
 
-    auto test = [&sel, n](glm::vec3 const& p) {
-        auto to_p = glm::normalize(p - sel.point);
-        auto d    = glm::dot(to_p, n);
-        return d > 0;
+SpatialIndex::Columns PointPlot::indexed_positions() const {
+    return {
+        .px = m_data_source.column<PX>(),
+        .py = m_data_source.column<PY>(),
+        .pz = m_data_source.column<PZ>(),
     };
+}
 
-    std::vector<int64_t> keys = build_select_keys(m_data_source, test);
+void PointPlot::prepare_queries() {
+    // queries run on workers, and only read the index
+    m_spatial_index.ensure(indexed_positions());
+}
 
-    m_data_source.table().modify_selection(
-        brush_selection_name, keys, sel.select);
+void PointPlot::rows_to_keys(std::vector<int64_t>& rows) const {
+    auto all_keys = m_data_source.table().get_all_keys();
+
+    // keep the selection in table order
+    std::sort(rows.begin(), rows.end());
+
+    for (auto& r : rows) {
+        r = all_keys[r];
+    }
+}
+
+// Selections are in the physical domain, like probes; they are mapped into
+// data space to query the index.
+
+std::vector<int64_t> PointPlot::select(SelectRegion const& sel) {
+    auto const& d = m_host->domain()->current_domain();
+
+    auto const a = d.inverse_transform(sel.min);
+    auto const b = d.inverse_transform(sel.max);
+
+    std::vector<int64_t> rows;
+
+    m_spatial_index.query_box(
+        indexed_positions(), glm::min(a, b), glm::max(a, b), rows);
+
+    rows_to_keys(rows);
+
+    return rows;
+}
+
+std::vector<int64_t> PointPlot::select(SelectSphere const& sel) {
+    auto const& d = m_host->domain()->current_domain();
+
+    std::vector<int64_t> rows;
+
+    // round in the physical domain, so possibly an ellipsoid in data space
+    m_spatial_index.query_sphere(indexed_positions(),
+                                 d.inverse_transform(sel.point),
+                                 sel.radius,
+                                 rows,
+                                 d.scale());
+
+    rows_to_keys(rows);
+
+    return rows;
+}
+
+std::vector<int64_t> PointPlot::select(SelectPlane const& sel) {
+    auto const& d = m_host->domain()->current_domain();
+
+    std::vector<int64_t> rows;
+
+    // the transform is a per-axis scale, and normals scale along with it
+    m_spatial_index.query_halfspace(indexed_positions(),
+                                    d.inverse_transform(sel.point),
+                                    glm::normalize(sel.normal * d.scale()),
+                                    rows);
+
+    rows_to_keys(rows);
+
+    return rows;
 }
 
 static bool is_point_in(glm::vec3 const&           p,
@@ -131,9 +315,9 @@ static bool is_point_in(glm::vec3 const&           p,
     int isect_count = 0;
 
     for (size_t i = 0; i < index.size(); i += 3) {
-        auto const& a = hull[i];
-        auto const& b = hull[i + 1];
-        auto const& c = hull[i + 2];
+        auto const& a = hull[index[i]];
+        auto const& b = hull[index[i + 1]];
+        auto const& c = hull[index[i + 2]];
 
         // if all the points are 'behind' the point, we can skip any testing
 
@@ -156,22 +340,41 @@ static bool is_point_in(glm::vec3 const&           p,
     return isect_count % 2 != 0;
 }
 
-void PointPlot::select(SelectHull const& sel) {
-    auto test = [&sel](glm::vec3 const& p) {
-        return is_point_in(p, sel.points, sel.index);
-    };
+std::vector<int64_t> PointPlot::select(SelectHull const& sel) {
+    if (sel.points.empty()) return {};
+
+    auto const& d = m_host->domain()->current_domain();
+
+    std::vector<glm::vec3> hull(sel.points.size());
+
+    std::transform(sel.points.begin(),
+                   sel.points.end(),
+                   hull.begin(),
+                   [&d](glm::vec3 p) { return d.inverse_transform(p); });
 
-    std::vector<int64_t> keys = build_select_keys(m_data_source, test);
+    // only points in the bounding box of the hull can be inside it
+    auto [lo, hi] = min_max_of(std::span<glm::vec3 const>(hull));
 
-    m_data_source.table().modify_selection(
-        brush_selection_name, keys, sel.select);
+    auto cols = indexed_positions();
+
+    std::vector<int64_t> rows;
+
+    m_spatial_index.query_box(cols, lo, hi, rows);
+
+    std::erase_if(rows, [&](int64_t row) {
+        return !is_point_in(cols.at(row), hull, sel.index);
+    });
+
+    rows_to_keys(rows);
+
+    return rows;
 }
 
 PointPlot::PointPlot(Plotty&                  host,
                      int64_t                  id,
-                     std::span<float const>   px,
-                     std::span<float const>   py,
-                     std::span<float const>   pz,
+                     QVector<float>&&         px,
+                     QVector<float>&&         py,
+                     QVector<float>&&         pz,
                      std::vector<glm::vec3>&& colors,
                      std::vector<glm::vec3>&& scales,
                      QStringList&&            strings)
@@ -180,11 +383,7 @@ PointPlot::PointPlot(Plotty&                  host,
     {
         auto num_points = px.size();
 
-        std::vector<LoadTableColumn> columns;
-
-        columns.emplace_back("x", px);
-        columns.emplace_back("y", py);
-        columns.emplace_back("z", pz);
+        QStringList headers = { "x", "y", "z" };
 
         m_column_mapping[PX] = 0;
         m_column_mapping[PY] = 1;
@@ -192,150 +391,292 @@ PointPlot::PointPlot(Plotty&                  host,
 
         int next_column = 3;
 
+        QVector<float> r, g, b;
+
         {
             if (colors.empty()) { colors.push_back({ 1, 1, 1 }); }
 
-            std::vector<double> r, g, b;
-
             r.resize(num_points);
             g.resize(num_points);
             b.resize(num_points);
 
-            for (size_t i = 0; i < num_points; i++) {
+            for (qsizetype i = 0; i < num_points; i++) {
                 r[i] = colors[i % colors.size()].x;
                 g[i] = colors[i % colors.size()].y;
                 b[i] = colors[i % colors.size()].z;
             }
 
-            columns.emplace_back("r", std::move(r));
-            columns.emplace_back("g", std::move(g));
-            columns.emplace_back("b", std::move(b));
+            headers << "r"
+                    << "g"
+                    << "b";
 
             m_column_mapping[CR] = next_column++;
             m_column_mapping[CG] = next_column++;
             m_column_mapping[CB] = next_column++;
         }
 
+        QVector<float> sx, sy, sz;
+
         {
             if (scales.empty()) { scales.push_back({ .02, .02, .02 }); }
 
             // so we are duplicating the values here to make the table a bit
             // more sane for viewers
-            std::vector<double> sx, sy, sz;
-
             sx.resize(num_points);
             sy.resize(num_points);
             sz.resize(num_points);
 
-            for (size_t i = 0; i < num_points; i++) {
+            for (qsizetype i = 0; i < num_points; i++) {
                 sx[i] = scales[i % scales.size()].x;
                 sy[i] = scales[i % scales.size()].y;
                 sz[i] = scales[i % scales.size()].z;
             }
 
-            columns.emplace_back("sx", std::move(sx));
-            columns.emplace_back("sy", std::move(sy));
-            columns.emplace_back("sz", std::move(sz));
+            headers << "sx"
+                    << "sy"
+                    << "sz";
 
             m_column_mapping[SX] = next_column++;
             m_column_mapping[SY] = next_column++;
             m_column_mapping[SZ] = next_column++;
         }
 
-        if (strings.size()) {
-            columns.emplace_back("annotation", std::move(strings));
-        }
-
-        auto tbl = std::make_shared<SpecType>(QString("Point Table %1").arg(id),
-                                              std::move(columns));
+        // the table pads this to the number of points
+        QVector<QString> annos(strings.begin(), strings.end());
+        strings.clear();
+
+        if (annos.size()) { headers << "annotation"; }
+
+        auto tbl = std::make_shared<SpecType>(
+            QString("Point Table %1").arg(id),
+            std::move(headers),
+            SpecType::TupleType(std::move(px),
+                                std::move(py),
+                                std::move(pz),
+                                std::move(r),
+                                std::move(g),
+                                std::move(b),
+                                std::move(sx),
+                                std::move(sy),
+                                std::move(sz),
+                                std::move(annos)));
 
         m_data_source = DataSource(m_doc, tbl);
     }
 
     auto str = QString("Spheres %1").arg(m_plot_id);
 
-    auto [pmat, pmesh, pobj] = build_common_sphere(str, m_doc);
+    m_glyph_type = wanted_glyph();
 
-    m_mat  = pmat;
-    m_mesh = pmesh;
-    m_obj  = pobj;
+    auto glyph = host.glyphs().get(m_glyph_type);
 
-    if (px.size()) {
-        auto [l, h] = min_max_of(px, py, pz);
-        host.domain()->ask_update_input_bounds(l, h);
-    }
+    m_mat  = glyph.material;
+    m_mesh = glyph.mesh;
+    m_obj  = make_glyph_group(str, m_doc, host.data_root());
+
+    register_part(m_obj);
+
+    m_pages = InstancePages(host, m_obj, m_mesh, str);
 
+    m_bounds_dirty = true;
+    publish_bounds();
+
+    // the bounds may have changed the domain, and so the glyph mesh
+    update_glyph();
     rebuild_instances();
 
+    m_data_source.table().set_retire_observer(
+        [this](std::span<int64_t const> rows) {
+            m_retired_rows.insert(
+                m_retired_rows.end(), rows.begin(), rows.end());
+
+            // once the box is dirty, there is no point in checking further
+            if (m_bounds_dirty) return;
+
+            auto cols = SpatialIndex::Columns {
+                .px = m_data_source.column<PX>(),
+                .py = m_data_source.column<PY>(),
+                .pz = m_data_source.column<PZ>(),
+            };
+
+            for (auto r : rows) {
+                if (r < 0) continue;
+
+                if (m_bounds.on_boundary(cols.at(r))) {
+                    m_bounds_dirty = true;
+                    return;
+                }
+            }
+        });
+
     connect(&m_data_source.table(),
             &SpecType::table_row_deleted,
             this,
-            &PointPlot::on_table_updated);
+            &PointPlot::on_table_rows_deleted);
 
     connect(&m_data_source.table(),
             &SpecType::table_row_updated,
             this,
-            &PointPlot::on_table_updated);
+            &PointPlot::on_table_rows_updated);
+
+    connect(&m_data_source.table(),
+            &SpecType::table_reset,
+            this,
+            &PointPlot::on_table_reset);
 }
 
-PointPlot::~PointPlot() { }
+PointPlot::~PointPlot() {
+    // the table may outlive us
+    m_data_source.table().set_retire_observer({});
+}
 
 
 void PointPlot::domain_updated(Domain const&) {
-    rebuild_instances();
+    // the domain itself is applied by the data root; glyphs only need a mesh
+    // for the new scale, the instances stay as they are
+    if (m_render_mode == RenderMode::Points) return;
+
+    update_glyph();
 }
 
 
-void PointPlot::handle_selection(SpatialSelection const& sel) {
-    std::visit([this](auto const& a) { this->select(a); }, sel);
+std::function<void()>
+PointPlot::prepare_selection(SpatialSelection const& sel) {
+    auto keys = std::visit([this](auto const& a) { return this->select(a); },
+                           sel);
+
+    auto action = std::visit([](auto const& a) { return a.select; }, sel);
+
+    return [this, keys = std::move(keys), action]() mutable {
+        m_data_source.table().modify_selection(
+            brush_selection_name, keys, action);
+    };
 }
 
 Plot::ProbeResult PointPlot::handle_probe(glm::vec3 const& probe_point) {
+    // the probe is in the physical domain; search in data space, but measure
+    // distance as it would appear after the domain transform
     float const cutoff_dist = .15;
 
-    auto const cutoff_dist_sq = cutoff_dist * cutoff_dist;
+    auto const& d = m_host->domain()->current_domain();
+
+    auto cols = indexed_positions();
+
+    auto best_row = m_spatial_index.query_nearest(
+        cols, d.inverse_transform(probe_point), cutoff_dist, d.scale());
+
+    if (best_row < 0) return {};
+
+    auto best_key = m_data_source.table().get_all_keys()[best_row];
+
+    QString text = QString("Key: %1").arg(best_key);
 
+    QString anno = m_data_source.column<ANNO>()[best_row];
+
+    if (!anno.isEmpty()) { // if there is an annotation field, use it.
+        text += ": " + anno;
+    }
+
+    return {
+        .text  = std::move(text),
+        .place = d.transform(cols.at(best_row)),
+    };
+}
+
+void PointPlot::on_table_rows_updated(QCborArray const& keys) {
     auto const& t = m_data_source.table();
 
-    auto all_keys = t.get_all_keys();
+    auto cols = SpatialIndex::Columns {
+        .px = m_data_source.column<PX>(),
+        .py = m_data_source.column<PY>(),
+        .pz = m_data_source.column<PZ>(),
+    };
 
-    int64_t   best_key     = -1;
-    float     best_dist_sq = cutoff_dist_sq; // others must be less than this...
-    glm::vec3 best_point;
+    auto const first_new = m_pending_rows.size();
 
-    for (size_t i = 0; i < all_keys.size(); i++) {
-        auto key = all_keys[i];
+    m_pending_rows.reserve(m_pending_rows.size() + keys.size());
 
-        auto p = glm::vec3(t.template get_column_at_key<PX>(key),
-                           t.template get_column_at_key<PY>(key),
-                           t.template get_column_at_key<PZ>(key));
+    for (auto const& k : keys) {
+        auto row = t.row_of(k.toInteger(-1));
 
-        auto dist_sq = glm::distance2(p, probe_point);
+        if (row < 0) continue;
 
-        if (best_dist_sq <= dist_sq) continue;
+        // new and updated rows can only grow the box
+        m_bounds.extend(cols.at(row));
 
-        best_key     = i;
-        best_dist_sq = dist_sq;
-        best_point   = p;
+        m_pending_rows.push_back(row);
     }
 
+    // appended rows land in the index tail; rewritten ones are set aside
+    m_spatial_index.update_rows(
+        std::span(m_pending_rows).subspan(first_new));
 
-    if (best_key < 0) return {};
+    m_retired_rows.clear();
 
-    QString text = QString("Key: %1").arg(best_key);
+    m_data_pending = true;
+    mark_dirty();
+}
 
-    QString anno = t.template get_column_at_key<ANNO>(best_key);
+void PointPlot::on_table_rows_deleted() {
+    // the retired rows are numbered as they were before the delete
+    m_spatial_index.remove_rows(m_retired_rows);
 
-    if (anno.isEmpty()) { // if there is an annotation field, use it.
-        text += ": " + anno;
+    // everything after the first deleted row has moved
+    if (!m_retired_rows.empty()) {
+        auto first = *std::min_element(m_retired_rows.begin(),
+                                       m_retired_rows.end());
+
+        m_pending_from = std::min(m_pending_from, size_t(first));
     }
 
-    return {
-        .text  = std::move(text),
-        .place = best_point,
-    };
+    m_retired_rows.clear();
+
+    m_data_pending = true;
+    mark_dirty();
 }
 
-void PointPlot::on_table_updated() {
-    rebuild_instances();
+void PointPlot::on_table_reset() {
+    m_spatial_index.invalidate();
+
+    m_bounds       = Bounds();
+    m_bounds_dirty = false;
+
+    m_retired_rows.clear();
+
+    m_pending_rows.clear();
+    m_pending_from = 0;
+
+    m_data_pending = true;
+    mark_dirty();
+}
+
+void PointPlot::flush_data() {
+    if (!std::exchange(m_data_pending, false)) return;
+
+    auto const count = m_data_source.column<PX>().size();
+
+    // rows at or past a deletion have moved, and are covered by the tail
+    auto const moved = std::min(m_pending_from, count);
+
+    std::vector<int64_t> rows;
+    rows.reserve(m_pending_rows.size());
+
+    for (auto r : m_pending_rows) {
+        if (size_t(r) < moved) rows.push_back(r);
+    }
+
+    auto ranges = rows_to_ranges(std::move(rows));
+
+    if (moved < count) ranges.push_back({ moved, count });
+
+    m_pending_rows.clear();
+    m_pending_from = std::numeric_limits<size_t>::max();
+
+    data_updated(ranges);
+}
+
+bool PointPlot::owns_object(noo::ObjectTPtr const& obj) const {
+    if (Plot::owns_object(obj) or m_pages.contains(obj)) return true;
+
+    return obj and obj == m_point_obj;
 }
@@ -5,7 +5,17 @@
 #include "plotty.h"
 
 #include "datasource.h"
+#include "glyphs.h"
 #include "scattercore.h"
+#include "spatialindex.h"
+
+#include <limits>
+#include <optional>
+
+enum class RenderMode {
+    Glyphs, // a glyph instance per point
+    Points, // a single mesh of points, colored but not scaled
+};
 
 class PointPlot : public Plot {
 
@@ -24,33 +34,107 @@ protected:
 
     DataSource<SpecType> m_data_source;
 
-    ScatterCore m_scatter_instances;
+    ScatterCore   m_scatter_instances;
+    InstancePages m_pages;
+
+    SpatialIndex m_spatial_index;
+
+    // rows written while a full rebuild is running
+    std::vector<RowRange> m_rows_behind;
+
+    // the sphere detail in use, and the one asked for, if any
+    GlyphType                m_glyph_type = GlyphType::Sphere;
+    std::optional<GlyphType> m_glyph_override;
+
+    RenderMode      m_render_mode = RenderMode::Glyphs;
+    noo::MeshTPtr   m_point_mesh;
+    noo::ObjectTPtr m_point_obj;
+
+    void rebuild_point_cloud();
+
+    GlyphType wanted_glyph() const;
+
+    /// \brief Switch glyph meshes if the wanted detail or the domain changed
+    void update_glyph();
+
+    // bounds of all positions. If dirty, an extreme point has been removed and
+    // the box may be too large.
+    Bounds m_bounds;
+    bool   m_bounds_dirty = false;
 
+    // rows the table is about to overwrite or delete
+    std::vector<int64_t> m_retired_rows;
+
+    // changes since the last flush: rows written, and the first row that
+    // has moved, if any
+    bool                 m_data_pending = false;
+    std::vector<int64_t> m_pending_rows;
+    size_t               m_pending_from = std::numeric_limits<size_t>::max();
+
+    ScatterCore::ArrayRef instance_source() const;
+
+    ///
+    /// \brief Rebuild every instance on the task pool.
+    ///
+    /// The build works from a snapshot of the columns, and is superseded by
+    /// the next full rebuild. Row updates made meanwhile are held, and applied
+    /// once the result is in.
+    ///
     void rebuild_instances();
+    void rebuild_rows(std::span<RowRange const>);
+
+    /// \brief Recompute the bounds if needed, and report them to the domain
+    void publish_bounds();
+
+    /// \brief Publish bounds and rebuild the given rows, without building
+    /// twice
+    void data_updated(std::span<RowRange const> rows);
+
+    /// \brief The positions the spatial index covers
+    SpatialIndex::Columns indexed_positions() const;
 
-    void select(SelectRegion const&);
-    void select(SelectSphere const&);
-    void select(SelectPlane const&);
-    void select(SelectHull const&);
+    /// \brief Convert rows to keys in place, in row order
+    void rows_to_keys(std::vector<int64_t>& rows) const;
+
+    // these return the keys hit, and are safe to run off the main thread
+    std::vector<int64_t> select(SelectRegion const&);
+    std::vector<int64_t> select(SelectSphere const&);
+    std::vector<int64_t> select(SelectPlane const&);
+    std::vector<int64_t> select(SelectHull const&);
 
 public:
     PointPlot(Plotty&                  host,
               int64_t                  id,
-              std::span<float const>   px,
-              std::span<float const>   py,
-              std::span<float const>   pz,
+              QVector<float>&&         px,
+              QVector<float>&&         py,
+              QVector<float>&&         pz,
               std::vector<glm::vec3>&& colors,
               std::vector<glm::vec3>&& scales,
               QStringList&&            strings);
     ~PointPlot() override;
 
     void domain_updated(Domain const&) override;
+    void flush_data() override;
+
+    void prepare_queries() override;
 
-    void handle_selection(SpatialSelection const&) override;
+    std::function<void()> prepare_selection(SpatialSelection const&) override;
 
     ProbeResult handle_probe(glm::vec3 const&) override;
 
+    bool owns_object(noo::ObjectTPtr const&) const override;
+
+    ///
+    /// \brief Force a sphere detail, or pick it from the triangle budget if
+    /// empty.
+    ///
+    void set_glyph_detail(std::optional<GlyphType>);
+
+    void set_render_mode(RenderMode);
+
 private slots:
-    void on_table_updated();
+    void on_table_rows_deleted();
+    void on_table_rows_updated(QCborArray const& keys);
+    void on_table_reset();
 };
 #endif // POINTPLOT_H
@@ -0,0 +1,20 @@
+#include "polylineplot.h"
+
+PolylinePlot::PolylinePlot(Plotty&                    host,
+                           int64_t                    id,
+                           std::span<float const>     px,
+                           std::span<float const>     py,
+                           std::span<float const>     pz,
+                           std::span<glm::vec3 const> colors,
+                           std::span<glm::vec2 const> scales)
+    : SegmentPlot(host,
+                  id,
+                  SegmentTopology::Strip,
+                  "Polyline",
+                  px,
+                  py,
+                  pz,
+                  colors,
+                  scales) { }
+
+PolylinePlot::~PolylinePlot() { }
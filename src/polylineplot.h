@@ -0,0 +1,25 @@
+#ifndef POLYLINEPLOT_H
+#define POLYLINEPLOT_H
+
+#include "segmentplot.h"
+
+///
+/// \brief A connected line through points in order.
+///
+/// Each vertex is stored once, and shared by the segments on either side of
+/// it, where a segment plot would need both endpoints of every segment.
+///
+class PolylinePlot : public SegmentPlot {
+public:
+    PolylinePlot(Plotty&                    host,
+                 int64_t                    id,
+                 std::span<float const>     px,
+                 std::span<float const>     py,
+                 std::span<float const>     pz,
+                 std::span<glm::vec3 const> colors,
+                 std::span<glm::vec2 const> scales);
+
+    ~PolylinePlot() override;
+};
+
+#endif // POLYLINEPLOT_H
@@ -1,104 +1,501 @@
 #include "scattercore.h"
 
+#include "taskpool.h"
+#include "utility.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    include <immintrin.h>
+#endif
+
 ScatterCore::ScatterCore() { }
 
 
-void ScatterCore::build_instances(std::span<glm::vec3> points,
-                                  std::span<glm::vec3> colors,
-                                  std::span<glm::vec3> scales,
-                                  Domain const&        domain) {
+namespace {
 
-    auto count = points.size();
+// Instance kernels ============================================================
+//
+// Each instance is a column-major mat4: position, color, rotation and scale.
+// Colors and scales are either given per point, or a single value broadcast
+// to every point; the kernels are specialized on both so the inner loops are
+// branch free. Positions stay in data space; the plot is placed under the
+// domain transform, and glyph meshes undo its scale.
 
-    if (count == 0) {
-        m_instances.clear();
-        return;
-    }
+struct KernelArgs {
+    float const* px;
+    float const* py;
+    float const* pz;
 
-    m_instances.resize(count);
+    float const* cr;
+    float const* cg;
+    float const* cb;
 
-    if (m_instances.empty()) return;
+    float const* sx;
+    float const* sy;
+    float const* sz;
 
-    glm::vec3 default_col(1);
-    glm::vec3 default_scale(1);
+    // instance i is written at out + (i - out_first) * 16
+    float* out;
+    size_t out_first;
+};
+
+template <bool PerPointColor, bool PerPointScale>
+void kernel_scalar(KernelArgs const& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        float* m = a.out + (i - a.out_first) * 16;
+
+        size_t const ci = PerPointColor ? i : 0;
+        size_t const si = PerPointScale ? i : 0;
+
+        m[0] = a.px[i];
+        m[1] = a.py[i];
+        m[2] = a.pz[i];
+        m[3] = 1;
+
+        m[4] = a.cr[ci];
+        m[5] = a.cg[ci];
+        m[6] = a.cb[ci];
+        m[7] = 1;
+
+        m[8]  = 0;
+        m[9]  = 0;
+        m[10] = 0;
+        m[11] = 1;
+
+        m[12] = a.sx[si];
+        m[13] = a.sy[si];
+        m[14] = a.sz[si];
+        m[15] = 1;
+    }
+}
 
-    std::span<glm::vec3> col_array =
-        colors.size() ? std::span<glm::vec3>(colors)
-                      : std::span<glm::vec3>(&default_col, 1);
+#if defined(__x86_64__) || defined(_M_X64)
+#    define PLOTTY_HAS_SSE 1
 
-    std::span<glm::vec3> scale_array =
-        scales.size() ? std::span<glm::vec3>(scales)
-                      : std::span<glm::vec3>(&default_scale, 1);
+// SSE2 is part of x86-64, so this needs no dispatch
+template <bool PerPointColor, bool PerPointScale>
+void kernel_sse(KernelArgs const& a, size_t begin, size_t end) {
+    __m128 const rot = _mm_setr_ps(0, 0, 0, 1);
 
-    for (size_t i = 0; i < count; i++) {
-        glm::mat4& m = m_instances[i];
+    __m128 const b_col   = _mm_setr_ps(a.cr[0], a.cg[0], a.cb[0], 1);
+    __m128 const b_scale = _mm_setr_ps(a.sx[0], a.sy[0], a.sz[0], 1);
 
-        m[0] = glm::vec4(domain.transform(points[i]), 1);
-        m[1] = glm::vec4(col_array[i % col_array.size()], 1);
-        m[2] = glm::vec4(0, 0, 0, 1);
-        m[3] = glm::vec4(scale_array[i % scale_array.size()], 1);
+    // transpose four SoA registers into four instance columns
+    auto store_column = [](float* m, size_t col, __m128 x, __m128 y, __m128 z) {
+        __m128 w = _mm_set1_ps(1);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        _mm_storeu_ps(m + 0 * 16 + col, x);
+        _mm_storeu_ps(m + 1 * 16 + col, y);
+        _mm_storeu_ps(m + 2 * 16 + col, z);
+        _mm_storeu_ps(m + 3 * 16 + col, w);
     };
+
+    auto store_const = [](float* m, size_t col, __m128 v) {
+        for (size_t k = 0; k < 4; k++) {
+            _mm_storeu_ps(m + k * 16 + col, v);
+        }
+    };
+
+    size_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        float* m = a.out + (i - a.out_first) * 16;
+
+        store_column(m,
+                     0,
+                     _mm_loadu_ps(a.px + i),
+                     _mm_loadu_ps(a.py + i),
+                     _mm_loadu_ps(a.pz + i));
+
+        if constexpr (PerPointColor) {
+            store_column(m,
+                         4,
+                         _mm_loadu_ps(a.cr + i),
+                         _mm_loadu_ps(a.cg + i),
+                         _mm_loadu_ps(a.cb + i));
+        } else {
+            store_const(m, 4, b_col);
+        }
+
+        store_const(m, 8, rot);
+
+        if constexpr (PerPointScale) {
+            store_column(m,
+                         12,
+                         _mm_loadu_ps(a.sx + i),
+                         _mm_loadu_ps(a.sy + i),
+                         _mm_loadu_ps(a.sz + i));
+        } else {
+            store_const(m, 12, b_scale);
+        }
+    }
+
+    kernel_scalar<PerPointColor, PerPointScale>(a, i, end);
 }
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#    define PLOTTY_HAS_AVX2 1
+#    define PLOTTY_TARGET_AVX2 __attribute__((target("avx2")))
+
+// transpose four 8-wide SoA registers, and write one column of 8 instances
+PLOTTY_TARGET_AVX2 inline void
+store_column_avx2(float* m, size_t col, __m256 x, __m256 y, __m256 z) {
+    __m256 const w = _mm256_set1_ps(1);
 
-template <class T>
-T const& modulus_indexed(std::span<T> t, size_t index) {
-    return t[index % t.size()];
+    __m256 t0 = _mm256_unpacklo_ps(x, y); // x0 y0 x1 y1 | x4 y4 x5 y5
+    __m256 t1 = _mm256_unpackhi_ps(x, y); // x2 y2 x3 y3 | x6 y6 x7 y7
+    __m256 t2 = _mm256_unpacklo_ps(z, w);
+    __m256 t3 = _mm256_unpackhi_ps(z, w);
+
+    __m256 v0 = _mm256_shuffle_ps(t0, t2, 0x44); // instance 0 | 4
+    __m256 v1 = _mm256_shuffle_ps(t0, t2, 0xEE); // instance 1 | 5
+    __m256 v2 = _mm256_shuffle_ps(t1, t3, 0x44); // instance 2 | 6
+    __m256 v3 = _mm256_shuffle_ps(t1, t3, 0xEE); // instance 3 | 7
+
+    _mm_storeu_ps(m + 0 * 16 + col, _mm256_castps256_ps128(v0));
+    _mm_storeu_ps(m + 1 * 16 + col, _mm256_castps256_ps128(v1));
+    _mm_storeu_ps(m + 2 * 16 + col, _mm256_castps256_ps128(v2));
+    _mm_storeu_ps(m + 3 * 16 + col, _mm256_castps256_ps128(v3));
+    _mm_storeu_ps(m + 4 * 16 + col, _mm256_extractf128_ps(v0, 1));
+    _mm_storeu_ps(m + 5 * 16 + col, _mm256_extractf128_ps(v1, 1));
+    _mm_storeu_ps(m + 6 * 16 + col, _mm256_extractf128_ps(v2, 1));
+    _mm_storeu_ps(m + 7 * 16 + col, _mm256_extractf128_ps(v3, 1));
 }
 
-template <class T>
-std::span<T const> seat_span(std::span<T const> source, T const& def) {
-    return source.size() ? source : std::span<T const>(&def, 1);
+PLOTTY_TARGET_AVX2 inline void store_const_avx2(float* m, size_t col, __m128 v) {
+    for (size_t k = 0; k < 8; k++) {
+        _mm_storeu_ps(m + k * 16 + col, v);
+    }
 }
 
+template <bool PerPointColor, bool PerPointScale>
+PLOTTY_TARGET_AVX2 void
+kernel_avx2(KernelArgs const& a, size_t begin, size_t end) {
+    __m128 const rot = _mm_setr_ps(0, 0, 0, 1);
 
-void ScatterCore::build_instances(ArrayRef const& ref, Domain const& domain) {
-    auto count = ref.px.size();
+    __m128 const b_col   = _mm_setr_ps(a.cr[0], a.cg[0], a.cb[0], 1);
+    __m128 const b_scale = _mm_setr_ps(a.sx[0], a.sy[0], a.sz[0], 1);
 
-    if (count == 0) {
-        m_instances.clear();
-        glm::mat4& m = m_instances.emplace_back();
+    size_t i = begin;
 
-        m[0] = glm::vec4(0, 0, 0, 1);
-        m[1] = glm::vec4(0, 0, 0, 1);
-        m[2] = glm::vec4(0, 0, 0, 1);
-        m[3] = glm::vec4(0, 0, 0, 1);
+    for (; i + 8 <= end; i += 8) {
+        float* m = a.out + (i - a.out_first) * 16;
+
+        store_column_avx2(m,
+                          0,
+                          _mm256_loadu_ps(a.px + i),
+                          _mm256_loadu_ps(a.py + i),
+                          _mm256_loadu_ps(a.pz + i));
+
+        if constexpr (PerPointColor) {
+            store_column_avx2(m,
+                              4,
+                              _mm256_loadu_ps(a.cr + i),
+                              _mm256_loadu_ps(a.cg + i),
+                              _mm256_loadu_ps(a.cb + i));
+        } else {
+            store_const_avx2(m, 4, b_col);
+        }
+
+        store_const_avx2(m, 8, rot);
+
+        if constexpr (PerPointScale) {
+            store_column_avx2(m,
+                              12,
+                              _mm256_loadu_ps(a.sx + i),
+                              _mm256_loadu_ps(a.sy + i),
+                              _mm256_loadu_ps(a.sz + i));
+        } else {
+            store_const_avx2(m, 12, b_scale);
+        }
+    }
+
+    kernel_scalar<PerPointColor, PerPointScale>(a, i, end);
+}
+#endif
+
+enum class SimdLevel { Scalar, SSE, AVX2 };
+
+SimdLevel detect_simd_level() {
+#if defined(PLOTTY_HAS_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+#endif
+#if defined(PLOTTY_HAS_SSE)
+    return SimdLevel::SSE;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel const simd_level = detect_simd_level();
+
+template <bool PerPointColor, bool PerPointScale>
+void run_kernel(KernelArgs const& a, size_t begin, size_t end) {
+    switch (simd_level) {
+#if defined(PLOTTY_HAS_AVX2)
+    case SimdLevel::AVX2:
+        kernel_avx2<PerPointColor, PerPointScale>(a, begin, end);
         return;
+#endif
+#if defined(PLOTTY_HAS_SSE)
+    case SimdLevel::SSE:
+        kernel_sse<PerPointColor, PerPointScale>(a, begin, end);
+        return;
+#endif
+    default: kernel_scalar<PerPointColor, PerPointScale>(a, begin, end);
     }
+}
 
-    m_instances.resize(count);
+void dispatch_kernel(KernelArgs const& a,
+                     bool              per_point_color,
+                     bool              per_point_scale,
+                     size_t            begin,
+                     size_t            end) {
+    if (per_point_color) {
+        if (per_point_scale) return run_kernel<true, true>(a, begin, end);
+        return run_kernel<true, false>(a, begin, end);
+    }
 
-    if (m_instances.empty()) return;
+    if (per_point_scale) return run_kernel<false, true>(a, begin, end);
+    return run_kernel<false, false>(a, begin, end);
+}
+
+///
+/// \brief Three columns that are either one value per point, or one value
+/// broadcast to all points.
+///
+/// Columns of any other length are expanded by repeating them.
+///
+struct SeatedGroup {
+    std::array<float const*, 3> cols;
+    bool                        per_point = false;
+    std::vector<float>          storage;
+};
+
+SeatedGroup seat_group(std::array<std::span<float const>, 3> const& src,
+                       glm::vec3                                     def,
+                       size_t                                        count) {
+    SeatedGroup ret;
+
+    bool all_full = true;
+    bool all_one  = true;
+
+    for (auto const& s : src) {
+        all_full = all_full and s.size() == count;
+        all_one  = all_one and s.size() <= 1;
+    }
+
+    if (all_full) {
+        ret.per_point = true;
+        for (size_t c = 0; c < 3; c++) {
+            ret.cols[c] = src[c].data();
+        }
+        return ret;
+    }
+
+    if (all_one) {
+        ret.storage.resize(3);
+        for (size_t c = 0; c < 3; c++) {
+            ret.storage[c] = src[c].empty() ? def[c] : src[c][0];
+            ret.cols[c]    = ret.storage.data() + c;
+        }
+        return ret;
+    }
+
+    ret.per_point = true;
+    ret.storage.resize(count * 3);
+
+    for (size_t c = 0; c < 3; c++) {
+        auto const& s    = src[c];
+        float*      dest = ret.storage.data() + c * count;
+
+        for (size_t i = 0; i < count; i++) {
+            dest[i] = s.empty() ? def[c] : s[i % s.size()];
+        }
+
+        ret.cols[c] = dest;
+    }
+
+    return ret;
+}
+
+} // namespace
+
+// Build the given rows of out, which has one instance per point. Pages that
+// are rebuilt whole do not need their old contents. Once stop is requested,
+// the remaining pages are skipped.
+static void build_ranges(ScatterCore::ArrayRef const& ref,
+                         std::span<RowRange const>    rows,
+                         InstanceArena&               out,
+                         std::stop_token              stop = {}) {
+    auto count = ref.px.size();
+
+    if (count == 0 or rows.empty()) return;
 
     glm::vec3 default_col(1);
     glm::vec3 default_scale(.05);
 
-    auto col_r = seat_span(ref.cr, default_col.r);
-    auto col_g = seat_span(ref.cg, default_col.g);
-    auto col_b = seat_span(ref.cb, default_col.b);
-
-    auto scale_x = seat_span(ref.sx, default_scale.x);
-    auto scale_y = seat_span(ref.sy, default_scale.y);
-    auto scale_z = seat_span(ref.sz, default_scale.z);
-
-    for (size_t i = 0; i < count; i++) {
-        glm::mat4& m = m_instances[i];
-
-        auto p = glm::vec3 { ref.px[i], ref.py[i], ref.pz[i] };
-        auto c = glm::vec3 {
-            modulus_indexed(col_r, i),
-            modulus_indexed(col_g, i),
-            modulus_indexed(col_b, i),
-        };
-
-        auto s = glm::vec3 {
-            modulus_indexed(scale_x, i),
-            modulus_indexed(scale_y, i),
-            modulus_indexed(scale_z, i),
-        };
-
-        m[0] = glm::vec4(domain.transform(p), 1);
-        m[1] = glm::vec4(c, 1);
-        m[2] = glm::vec4(0, 0, 0, 1);
-        m[3] = glm::vec4(s, 1);
+    auto colors = seat_group({ ref.cr, ref.cg, ref.cb }, default_col, count);
+    auto scales = seat_group({ ref.sx, ref.sy, ref.sz }, default_scale, count);
+
+    KernelArgs args {
+        .px = ref.px.data(),
+        .py = ref.py.data(),
+        .pz = ref.pz.data(),
+
+        .cr = colors.cols[0],
+        .cg = colors.cols[1],
+        .cb = colors.cols[2],
+
+        .sx = scales.cols[0],
+        .sy = scales.cols[1],
+        .sz = scales.cols[2],
+
+        .out       = nullptr,
+        .out_first = 0,
+    };
+
+    // split the ranges at page boundaries; pages are claimed for writing here,
+    // as that may swap storage, and then filled in parallel
+    struct Piece {
+        float* out;
+        size_t first, begin, end;
     };
+
+    std::vector<Piece> pieces;
+
+    for (auto const& r : rows) {
+        for (auto b = r.begin; b < r.end;) {
+            auto const page  = b / InstanceArena::page_size;
+            auto const first = page * InstanceArena::page_size;
+            auto const last  = first + out.page_rows(page);
+            auto const e     = std::min(r.end, last);
+
+            bool const whole = b == first and e == last;
+
+            auto* dest = glm::value_ptr(*out.writable_page(page, !whole));
+
+            pieces.push_back({ dest, first, b, e });
+
+            b = e;
+        }
+    }
+
+    TaskPool::global().parallel_for(
+        0, pieces.size(), 1, [&](size_t pb, size_t pe) {
+            for (auto pi = pb; pi < pe; pi++) {
+                if (stop.stop_requested()) return;
+
+                auto const& piece = pieces[pi];
+
+                auto local      = args;
+                local.out       = piece.out;
+                local.out_first = piece.first;
+
+                dispatch_kernel(local,
+                                colors.per_point,
+                                scales.per_point,
+                                piece.begin,
+                                piece.end);
+            }
+        });
+}
+
+void ScatterCore::build_instances(ArrayRef const& ref) {
+    auto count = ref.px.size();
+
+    m_instances.resize(count);
+    m_dirty.clear();
+
+    if (count == 0) return;
+
+    m_dirty.push_back({ 0, count });
+
+    build_ranges(ref, m_dirty, m_instances);
+}
+
+void ScatterCore::build_all(ArrayRef const& ref,
+                            InstanceArena&  out,
+                            std::stop_token stop) {
+    auto count = ref.px.size();
+
+    out.resize(count);
+
+    RowRange all { 0, count };
+
+    build_ranges(ref, { &all, 1 }, out, stop);
+}
+
+void ScatterCore::adopt(InstanceArena&& instances) {
+    m_instances = std::move(instances);
+
+    m_dirty.clear();
+
+    if (m_instances.empty()) return;
+
+    m_dirty.push_back({ 0, m_instances.size() });
+}
+
+void ScatterCore::update_rows(ArrayRef const&           ref,
+                              std::span<RowRange const> rows) {
+    auto const old_count = m_instances.size();
+    auto const count     = ref.px.size();
+
+    m_instances.resize(count);
+
+    std::vector<RowRange> todo;
+
+    for (auto r : rows) {
+        r.end = std::min(r.end, std::min(count, old_count));
+        if (r.begin < r.end) todo.push_back(r);
+    }
+
+    if (count > old_count) todo.push_back({ old_count, count });
+
+    build_ranges(ref, todo, m_instances);
+
+    m_dirty.insert(m_dirty.end(), todo.begin(), todo.end());
+}
+
+std::vector<RowRange> ScatterCore::take_dirty() {
+    return std::exchange(m_dirty, {});
+}
+
+void ScatterCore::clear() {
+    m_instances.resize(0);
+    m_dirty.clear();
+}
+
+void ScatterCore::build_points(ArrayRef const&           ref,
+                               std::vector<glm::vec3>&   positions,
+                               std::vector<glm::u8vec4>& colors) {
+    auto count = ref.px.size();
+
+    positions.resize(count);
+    colors.resize(count);
+
+    auto colors_in =
+        seat_group({ ref.cr, ref.cg, ref.cb }, glm::vec3(1), count);
+
+    size_t const grain = 1 << 16;
+
+    TaskPool::global().parallel_for(0, count, grain, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            size_t const ci = colors_in.per_point ? i : 0;
+
+            positions[i] = { ref.px[i], ref.py[i], ref.pz[i] };
+            colors[i]    = pack_color(colors_in.cols[0][ci],
+                                   colors_in.cols[1][ci],
+                                   colors_in.cols[2][ci]);
+        }
+    });
 }
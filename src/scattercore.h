@@ -1,28 +1,71 @@
 #ifndef SCATTERCORE_H
 #define SCATTERCORE_H
 
+#include "instancepages.h"
 #include "plotty.h"
 
+#include <stop_token>
+
 class ScatterCore {
-    std::vector<glm::mat4> m_instances;
+    InstanceArena m_instances;
+
+    // rows changed since the last take_dirty()
+    std::vector<RowRange> m_dirty;
 
 public:
     ScatterCore();
 
-    void build_instances(std::span<glm::vec3> points,
-                         std::span<glm::vec3> colors,
-                         std::span<glm::vec3> scales,
-                         Domain const&);
-
     struct ArrayRef {
         std::span<float const> px, py, pz;
         std::span<float const> cr, cg, cb;
         std::span<float const> sx, sy, sz;
     };
 
-    void build_instances(ArrayRef const& ref, Domain const&);
+    ///
+    /// \brief Build instances in data space.
+    ///
+    /// Every row is marked dirty.
+    ///
+    void build_instances(ArrayRef const& ref);
+
+    ///
+    /// \brief Build instances for every row into out, as build_instances does.
+    ///
+    /// This touches nothing else, so it may run off the main thread. Once
+    /// stop is requested it returns early, leaving out incomplete.
+    ///
+    static void build_all(ArrayRef const& ref,
+                          InstanceArena&  out,
+                          std::stop_token stop = {});
+
+    /// \brief Take instances built elsewhere, and mark every row dirty.
+    void adopt(InstanceArena&&);
+
+    ///
+    /// \brief Rebuild only the given rows, and mark them dirty.
+    ///
+    /// The instance count follows the number of points; rows past the previous
+    /// count are always rebuilt.
+    ///
+    void update_rows(ArrayRef const& ref, std::span<RowRange const> rows);
+
+    /// \brief Get the ranges changed since the last call, and forget them.
+    std::vector<RowRange> take_dirty();
+
+    /// \brief Drop all instances
+    void clear();
+
+    ///
+    /// \brief Build vertices for drawing each point as a mesh point instead of
+    /// an instance.
+    ///
+    /// Colors are packed to 8 bits a channel; scales are not used.
+    ///
+    static void build_points(ArrayRef const&           ref,
+                             std::vector<glm::vec3>&   positions,
+                             std::vector<glm::u8vec4>& colors);
 
-    auto const& instances() const { return m_instances; }
+    InstanceArena const& instances() const { return m_instances; }
 
     bool empty() const { return m_instances.empty(); }
 };
@@ -0,0 +1,416 @@
+#include "segmentcore.h"
+
+#include "taskpool.h"
+#include "utility.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    include <immintrin.h>
+#endif
+
+void SegmentData::set_positions(std::span<float const> x,
+                                std::span<float const> y,
+                                std::span<float const> z) {
+    px.assign(x.begin(), x.end());
+    py.assign(y.begin(), y.end());
+    pz.assign(z.begin(), z.end());
+}
+
+void SegmentData::set_colors(std::span<glm::vec3 const> colors) {
+    auto const count = colors.size() > 1 ? vertex_count() : 1;
+
+    cr.resize(count);
+    cg.resize(count);
+    cb.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        auto c = colors.empty() ? glm::vec3(1) : colors[i % colors.size()];
+
+        cr[i] = c.r;
+        cg[i] = c.g;
+        cb[i] = c.b;
+    }
+}
+
+void SegmentData::set_scales(std::span<glm::vec2 const> s,
+                             size_t                     segment_count) {
+    auto const count = s.size() > 1 ? segment_count : 1;
+
+    scales.resize(count * 2);
+
+    for (size_t i = 0; i < count; i++) {
+        auto v = s.empty() ? glm::vec2(.05) : s[i % s.size()];
+
+        scales[i * 2 + 0] = v.x;
+        scales[i * 2 + 1] = v.y;
+    }
+}
+
+SegmentData
+SegmentData::gather_strip(std::span<uint32_t const> vertices) const {
+    SegmentData ret;
+
+    auto gather = [&](std::vector<float> const& src, std::vector<float>& dst) {
+        dst.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            dst[i] = src[vertices[i]];
+        }
+    };
+
+    gather(px, ret.px);
+    gather(py, ret.py);
+    gather(pz, ret.pz);
+
+    if (cr.size() > 1) {
+        gather(cr, ret.cr);
+        gather(cg, ret.cg);
+        gather(cb, ret.cb);
+    } else {
+        ret.cr = cr;
+        ret.cg = cg;
+        ret.cb = cb;
+    }
+
+    if (scales.size() > 2 and vertices.size() > 1) {
+        ret.scales.resize((vertices.size() - 1) * 2);
+
+        for (size_t i = 0; i + 1 < vertices.size(); i++) {
+            ret.scales[i * 2 + 0] = scales[vertices[i] * 2 + 0];
+            ret.scales[i * 2 + 1] = scales[vertices[i] * 2 + 1];
+        }
+    } else {
+        ret.scales = scales;
+    }
+
+    return ret;
+}
+
+size_t segment_count(size_t vertex_count, SegmentTopology topology) {
+    switch (topology) {
+    case SegmentTopology::Pairs: return vertex_count / 2;
+    case SegmentTopology::Strip: return vertex_count ? vertex_count - 1 : 0;
+    }
+    return 0;
+}
+
+namespace {
+
+// Segment kernels =============================================================
+//
+// Segment i runs from vertex i * Stride to the next vertex, so Stride is 2 for
+// pairs and 1 for strips. The tube mesh lies along X, from -0.5 to 0.5, with a
+// unit radius.
+//
+// For a segment D of length L, the shortest turn from +X onto D is the
+// quaternion (0, -Dz, Dy, L + Dx) / sqrt(2 L (L + Dx)). This breaks down as D
+// nears -X, where any half turn about an axis orthogonal to X will do; we use
+// Z. Zero length segments take the same path, and are flattened anyway.
+
+struct SegmentArgs {
+    float const* px;
+    float const* py;
+    float const* pz;
+
+    float const* cr;
+    float const* cg;
+    float const* cb;
+
+    float const* scales; // interleaved
+
+    // segment i is written at out + (i - out_first) * 16
+    float* out;
+    size_t out_first;
+};
+
+// below this, L + Dx is too close to cancelling out to trust
+float const min_turn = 1e-4f;
+
+template <size_t Stride, bool PerVertexColor, bool PerSegmentScale>
+void segment_scalar(SegmentArgs const& a, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        float* m = a.out + (i - a.out_first) * 16;
+
+        size_t const va = i * Stride;
+        size_t const vb = va + 1;
+
+        float const dx = a.px[vb] - a.px[va];
+        float const dy = a.py[vb] - a.py[va];
+        float const dz = a.pz[vb] - a.pz[va];
+
+        float const len = std::sqrt(dx * dx + dy * dy + dz * dz);
+        float const w   = len + dx;
+
+        m[0] = (a.px[va] + a.px[vb]) * .5f;
+        m[1] = (a.py[va] + a.py[vb]) * .5f;
+        m[2] = (a.pz[va] + a.pz[vb]) * .5f;
+        m[3] = 1;
+
+        size_t const ci = PerVertexColor ? va : 0;
+
+        m[4] = a.cr[ci];
+        m[5] = a.cg[ci];
+        m[6] = a.cb[ci];
+        m[7] = 1;
+
+        if (w > len * min_turn) {
+            float const inv = 1.0f / std::sqrt(2 * len * w);
+
+            m[8]  = 0;
+            m[9]  = -dz * inv;
+            m[10] = dy * inv;
+            m[11] = w * inv;
+        } else {
+            m[8]  = 0;
+            m[9]  = 0;
+            m[10] = 1;
+            m[11] = 0;
+        }
+
+        size_t const si = PerSegmentScale ? i : 0;
+
+        m[12] = len;
+        m[13] = a.scales[si * 2 + 0];
+        m[14] = a.scales[si * 2 + 1];
+        m[15] = 1;
+    }
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define PLOTTY_HAS_SSE 1
+
+// Get the first and second vertex of four segments
+template <size_t Stride>
+inline void
+load_ends(float const* p, size_t i, __m128& first, __m128& second) {
+    if constexpr (Stride == 1) {
+        first  = _mm_loadu_ps(p + i);
+        second = _mm_loadu_ps(p + i + 1);
+    } else {
+        __m128 const lo = _mm_loadu_ps(p + i * 2);
+        __m128 const hi = _mm_loadu_ps(p + i * 2 + 4);
+
+        first  = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        second = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+}
+
+// transpose four SoA registers into one column of four instances
+inline void
+store_column(float* m, size_t col, __m128 x, __m128 y, __m128 z, __m128 w) {
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(m + 0 * 16 + col, x);
+    _mm_storeu_ps(m + 1 * 16 + col, y);
+    _mm_storeu_ps(m + 2 * 16 + col, z);
+    _mm_storeu_ps(m + 3 * 16 + col, w);
+}
+
+// SSE2 is part of x86-64, so this needs no dispatch
+template <size_t Stride, bool PerVertexColor, bool PerSegmentScale>
+void segment_sse(SegmentArgs const& a, size_t begin, size_t end) {
+    __m128 const zero = _mm_setzero_ps();
+    __m128 const one  = _mm_set1_ps(1);
+    __m128 const half = _mm_set1_ps(.5f);
+    __m128 const two  = _mm_set1_ps(2);
+    __m128 const min  = _mm_set1_ps(min_turn);
+
+    __m128 const sign_bit = _mm_set1_ps(-0.0f);
+
+    __m128 const b_col = _mm_setr_ps(a.cr[0], a.cg[0], a.cb[0], 1);
+    __m128 const b_sx  = _mm_set1_ps(a.scales[0]);
+    __m128 const b_sy  = _mm_set1_ps(a.scales[1]);
+
+    size_t i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        float* m = a.out + (i - a.out_first) * 16;
+
+        __m128 ax, bx, ay, by, az, bz;
+        load_ends<Stride>(a.px, i, ax, bx);
+        load_ends<Stride>(a.py, i, ay, by);
+        load_ends<Stride>(a.pz, i, az, bz);
+
+        __m128 const dx = _mm_sub_ps(bx, ax);
+        __m128 const dy = _mm_sub_ps(by, ay);
+        __m128 const dz = _mm_sub_ps(bz, az);
+
+        __m128 const len = _mm_sqrt_ps(_mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+            _mm_mul_ps(dz, dz)));
+
+        __m128 const w = _mm_add_ps(len, dx);
+
+        store_column(m,
+                     0,
+                     _mm_mul_ps(_mm_add_ps(ax, bx), half),
+                     _mm_mul_ps(_mm_add_ps(ay, by), half),
+                     _mm_mul_ps(_mm_add_ps(az, bz), half),
+                     one);
+
+        if constexpr (PerVertexColor) {
+            __m128 r, g, b, unused;
+            load_ends<Stride>(a.cr, i, r, unused);
+            load_ends<Stride>(a.cg, i, g, unused);
+            load_ends<Stride>(a.cb, i, b, unused);
+
+            store_column(m, 4, r, g, b, one);
+        } else {
+            for (size_t k = 0; k < 4; k++) {
+                _mm_storeu_ps(m + k * 16 + 4, b_col);
+            }
+        }
+
+        // masked lanes may hold inf or nan, which the masks clear
+        __m128 const turn = _mm_cmpgt_ps(w, _mm_mul_ps(len, min));
+        __m128 const inv =
+            _mm_div_ps(one, _mm_sqrt_ps(_mm_mul_ps(two, _mm_mul_ps(len, w))));
+
+        __m128 const qy =
+            _mm_and_ps(turn, _mm_xor_ps(_mm_mul_ps(dz, inv), sign_bit));
+        __m128 const qz = _mm_or_ps(_mm_and_ps(turn, _mm_mul_ps(dy, inv)),
+                                    _mm_andnot_ps(turn, one));
+        __m128 const qw = _mm_and_ps(turn, _mm_mul_ps(w, inv));
+
+        store_column(m, 8, zero, qy, qz, qw);
+
+        __m128 sx = b_sx;
+        __m128 sy = b_sy;
+
+        if constexpr (PerSegmentScale) load_ends<2>(a.scales, i, sx, sy);
+
+        store_column(m, 12, len, sx, sy, one);
+    }
+
+    segment_scalar<Stride, PerVertexColor, PerSegmentScale>(a, i, end);
+}
+#endif
+
+template <size_t Stride, bool PerVertexColor, bool PerSegmentScale>
+void run_segment_kernel(SegmentArgs const& a, size_t begin, size_t end) {
+#if defined(PLOTTY_HAS_SSE)
+    segment_sse<Stride, PerVertexColor, PerSegmentScale>(a, begin, end);
+#else
+    segment_scalar<Stride, PerVertexColor, PerSegmentScale>(a, begin, end);
+#endif
+}
+
+template <size_t Stride>
+void dispatch_segment_kernel(SegmentArgs const& a,
+                             bool               per_vertex_color,
+                             bool               per_segment_scale,
+                             size_t             begin,
+                             size_t             end) {
+    if (per_vertex_color) {
+        if (per_segment_scale) {
+            return run_segment_kernel<Stride, true, true>(a, begin, end);
+        }
+        return run_segment_kernel<Stride, true, false>(a, begin, end);
+    }
+
+    if (per_segment_scale) {
+        return run_segment_kernel<Stride, false, true>(a, begin, end);
+    }
+    return run_segment_kernel<Stride, false, false>(a, begin, end);
+}
+
+} // namespace
+
+void build_segment_instances(SegmentData const& data,
+                             SegmentTopology    topology,
+                             InstanceArena&     out,
+                             std::stop_token    stop) {
+    auto const count = segment_count(data.vertex_count(), topology);
+
+    out.resize(count);
+
+    if (count == 0) return;
+
+    bool const per_vertex_color  = data.cr.size() > 1;
+    bool const per_segment_scale = data.scales.size() > 2;
+
+    SegmentArgs args {
+        .px = data.px.data(),
+        .py = data.py.data(),
+        .pz = data.pz.data(),
+
+        .cr = data.cr.data(),
+        .cg = data.cg.data(),
+        .cb = data.cb.data(),
+
+        .scales = data.scales.data(),
+
+        .out       = nullptr,
+        .out_first = 0,
+    };
+
+    // claiming a page may swap its storage, so do it before going parallel
+    std::vector<float*> pages(out.page_count());
+
+    for (size_t p = 0; p < pages.size(); p++) {
+        pages[p] = glm::value_ptr(*out.writable_page(p, false));
+    }
+
+    TaskPool::global().parallel_for(
+        0, pages.size(), 1, [&](size_t pb, size_t pe) {
+            for (auto p = pb; p < pe; p++) {
+                if (stop.stop_requested()) return;
+
+                auto local      = args;
+                local.out       = pages[p];
+                local.out_first = p * InstanceArena::page_size;
+
+                auto const b = local.out_first;
+                auto const e = b + out.page_rows(p);
+
+                if (topology == SegmentTopology::Pairs) {
+                    dispatch_segment_kernel<2>(
+                        local, per_vertex_color, per_segment_scale, b, e);
+                } else {
+                    dispatch_segment_kernel<1>(
+                        local, per_vertex_color, per_segment_scale, b, e);
+                }
+            }
+        });
+}
+
+void build_segment_lines(SegmentData const&        data,
+                         SegmentTopology           topology,
+                         std::vector<glm::vec3>&   positions,
+                         std::vector<glm::u8vec4>& colors,
+                         std::vector<glm::uvec2>&  indices) {
+    auto const count    = data.vertex_count();
+    auto const segments = segment_count(count, topology);
+
+    positions.resize(count);
+    colors.resize(count);
+    indices.resize(segments);
+
+    if (segments == 0) return;
+
+    bool const per_vertex_color = data.cr.size() > 1;
+
+    size_t const grain = 1 << 16;
+
+    TaskPool::global().parallel_for(0, count, grain, [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; i++) {
+            size_t const ci = per_vertex_color ? i : 0;
+
+            positions[i] = { data.px[i], data.py[i], data.pz[i] };
+            colors[i] = pack_color(data.cr[ci], data.cg[ci], data.cb[ci]);
+        }
+    });
+
+    uint32_t const stride = topology == SegmentTopology::Pairs ? 2 : 1;
+
+    TaskPool::global().parallel_for(
+        0, segments, grain, [&](size_t b, size_t e) {
+            for (size_t i = b; i < e; i++) {
+                auto const first = uint32_t(i) * stride;
+
+                indices[i] = { first, first + 1 };
+            }
+        });
+}
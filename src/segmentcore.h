@@ -0,0 +1,79 @@
+#ifndef SEGMENTCORE_H
+#define SEGMENTCORE_H
+
+#include "instancearena.h"
+
+#include <span>
+#include <stop_token>
+#include <vector>
+
+///
+/// \brief How vertices are joined into segments
+///
+enum class SegmentTopology {
+    Pairs, // a <-> b, c <-> d
+    Strip, // a <-> b <-> c <-> d
+};
+
+///
+/// \brief Vertices and attributes of a set of tube segments, column by column.
+///
+struct SegmentData {
+    std::vector<float> px, py, pz;
+
+    // one color per vertex, or a single color for all. A segment takes the
+    // color of its first vertex.
+    std::vector<float> cr, cg, cb;
+
+    // one 2D scale per segment, interleaved, or a single scale for all
+    std::vector<float> scales;
+
+    void set_positions(std::span<float const> x,
+                       std::span<float const> y,
+                       std::span<float const> z);
+
+    /// \brief Colors of any other length are repeated to cover every vertex.
+    void set_colors(std::span<glm::vec3 const>);
+
+    /// \brief Scales of any other length are repeated to cover every segment.
+    void set_scales(std::span<glm::vec2 const>, size_t segment_count);
+
+    size_t vertex_count() const { return px.size(); }
+
+    ///
+    /// \brief Build a strip through some of our vertices, in order.
+    ///
+    /// Each new segment takes the scale of the segment that started at the
+    /// same vertex.
+    ///
+    SegmentData gather_strip(std::span<uint32_t const> vertices) const;
+};
+
+size_t segment_count(size_t vertex_count, SegmentTopology);
+
+///
+/// \brief Build one tube instance per segment.
+///
+/// Each tube is placed at the segment midpoint, turned from +X onto the
+/// segment, and stretched to its length, so it meets both endpoints in data
+/// space. The tube mesh undoes the domain scale on the radius.
+///
+/// Once stop is requested, the remaining pages are skipped.
+///
+void build_segment_instances(SegmentData const& data,
+                             SegmentTopology    topology,
+                             InstanceArena&     out,
+                             std::stop_token    stop = {});
+
+///
+/// \brief Build a line mesh of the segments, with a pair of indices for each.
+///
+/// Colors are packed to 8 bits a channel; scales are not used.
+///
+void build_segment_lines(SegmentData const&        data,
+                         SegmentTopology           topology,
+                         std::vector<glm::vec3>&   positions,
+                         std::vector<glm::u8vec4>& colors,
+                         std::vector<glm::uvec2>&  indices);
+
+#endif // SEGMENTCORE_H
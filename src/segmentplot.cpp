@@ -0,0 +1,252 @@
+#include "segmentplot.h"
+
+#include "glyphs.h"
+#include "utility.h"
+
+#include <utility>
+
+SegmentStyle SegmentPlot::wanted_style() const {
+    if (m_style_override) return *m_style_override;
+
+    return segment_count() > m_host->options().line_threshold
+               ? SegmentStyle::Lines
+               : SegmentStyle::Tubes;
+}
+
+// Pick the vertices to draw. Returns true if they may have changed.
+bool SegmentPlot::update_decimation() {
+    bool const over = m_topology == SegmentTopology::Strip and
+                      m_vertex_budget > 0 and
+                      m_data->vertex_count() > m_vertex_budget;
+
+    if (!over) {
+        if (!m_decimate) return false;
+
+        m_decimate = false;
+        m_decimated.reset();
+        return true;
+    }
+
+    if (!m_pyramid) m_pyramid.emplace(*m_data);
+
+    auto vertices = m_pyramid->select(*m_data, m_vertex_budget, m_focus);
+
+    m_decimated = std::make_shared<SegmentData const>(
+        m_data->gather_strip(vertices));
+    m_decimate = true;
+    return true;
+}
+
+void SegmentPlot::set_focus(std::optional<Bounds> focus) {
+    if (focus == m_focus) return;
+
+    m_focus = focus;
+
+    // the focus only matters when decimating
+    if (!m_decimate) return;
+
+    // probes move the focus far more often than we can redraw
+    m_focus_changed = true;
+    mark_dirty();
+}
+
+void SegmentPlot::flush_data() {
+    if (!std::exchange(m_focus_changed, false)) return;
+
+    if (update_decimation()) rebuild();
+}
+
+// Bring whatever is drawn in line with the shown data and the wanted style
+void SegmentPlot::rebuild() {
+    auto const style = wanted_style();
+
+    if (style != m_style) {
+        m_style = style;
+
+        if (m_style == SegmentStyle::Lines) {
+            cancel_rebuild();
+
+            // drops every page
+            m_instances.resize(0);
+            m_pages.update(m_instances, {});
+        } else {
+            m_line_obj.reset();
+            m_line_mesh.reset();
+        }
+    }
+
+    if (m_style == SegmentStyle::Lines) {
+        rebuild_lines();
+    } else {
+        rebuild_instances();
+    }
+}
+
+void SegmentPlot::update_glyph() {
+    auto glyph = m_host->glyphs().get(GlyphType::Tube);
+
+    if (glyph.mesh == m_mesh) return;
+
+    m_mat  = glyph.material;
+    m_mesh = glyph.mesh;
+
+    m_pages.set_mesh(m_mesh);
+}
+
+void SegmentPlot::rebuild_instances() {
+    // the domain may have moved on while we drew lines
+    update_glyph();
+
+    start_rebuild(
+        [data = shown(), topology = m_topology](std::stop_token stop) {
+            InstanceArena out;
+            build_segment_instances(*data, topology, out, stop);
+            return out;
+        },
+        [this](InstanceArena out) {
+            m_instances = std::move(out);
+
+            // segment plots are rebuilt whole, so every page is dirty
+            RowRange all { 0, m_instances.size() };
+
+            m_pages.update(m_instances, { &all, 1 });
+        });
+}
+
+void SegmentPlot::rebuild_lines() {
+    std::vector<glm::vec3>   positions;
+    std::vector<glm::u8vec4> colors;
+    std::vector<glm::uvec2>  indices;
+
+    build_segment_lines(*shown(), m_topology, positions, colors, indices);
+
+    if (indices.empty()) {
+        m_line_obj.reset();
+        m_line_mesh.reset();
+        return;
+    }
+
+    noo::MeshSource mesh_data;
+    mesh_data.material     = m_mat;
+    mesh_data.positions    = positions;
+    mesh_data.colors       = colors;
+    mesh_data.indices      = std::as_bytes(std::span(indices));
+    mesh_data.index_format = noo::Format::U32;
+    mesh_data.type         = noo::MeshSource::LINE;
+
+    show_mesh_part(mesh_data,
+                   positions.size() * sizeof(glm::vec3) +
+                       colors.size() * sizeof(glm::u8vec4) +
+                       indices.size() * sizeof(glm::uvec2),
+                   m_name + " Lines",
+                   m_line_mesh,
+                   m_line_obj);
+}
+
+SegmentPlot::SegmentPlot(Plotty&                    host,
+                         int64_t                    id,
+                         SegmentTopology            topology,
+                         QString                    kind,
+                         std::span<float const>     px,
+                         std::span<float const>     py,
+                         std::span<float const>     pz,
+                         std::span<glm::vec3 const> colors,
+                         std::span<glm::vec2 const> scales)
+    : Plot(host, id), m_topology(topology) {
+
+    {
+        SegmentData data;
+        data.set_positions(px, py, pz);
+        data.set_colors(colors);
+        data.set_scales(scales, ::segment_count(px.size(), topology));
+
+        m_data = std::make_shared<SegmentData const>(std::move(data));
+    }
+
+    m_name     = QString("%1 %2").arg(kind).arg(m_plot_id);
+    auto glyph = host.glyphs().get(GlyphType::Tube);
+
+    m_mat  = glyph.material;
+    m_mesh = glyph.mesh;
+    m_obj  = make_glyph_group(m_name, m_doc, host.data_root());
+
+    register_part(m_obj);
+
+    m_pages = InstancePages(host, m_obj, m_mesh, m_name);
+
+    m_vertex_budget = host.options().vertex_budget;
+    update_decimation();
+
+    m_style = wanted_style();
+
+    if (px.size()) {
+        auto [l, h] = min_max_of(px, py, pz);
+
+        host.domain()->update_plot_bounds(m_plot_id, { l, h });
+    }
+
+    if (m_style == SegmentStyle::Lines) {
+        rebuild_lines();
+        return;
+    }
+
+    rebuild_instances();
+}
+
+SegmentPlot::~SegmentPlot() { }
+
+size_t SegmentPlot::segment_count() const {
+    return ::segment_count(shown()->vertex_count(), m_topology);
+}
+
+void SegmentPlot::set_style(std::optional<SegmentStyle> style) {
+    m_style_override = style;
+
+    if (wanted_style() == m_style) return;
+
+    rebuild();
+}
+
+void SegmentPlot::set_vertex_budget(size_t budget) {
+    if (budget == m_vertex_budget) return;
+
+    m_vertex_budget = budget;
+
+    if (update_decimation()) rebuild();
+}
+
+bool SegmentPlot::owns_object(noo::ObjectTPtr const& obj) const {
+    if (Plot::owns_object(obj) or m_pages.contains(obj)) return true;
+
+    return obj and obj == m_line_obj;
+}
+
+void SegmentPlot::domain_updated(Domain const&) {
+    // only tube sizes depend on the domain, and the mesh takes care of that
+    if (m_style == SegmentStyle::Lines) return;
+
+    update_glyph();
+}
+
+std::function<void()>
+SegmentPlot::prepare_selection(SpatialSelection const& sel) {
+    auto focus = selection_focus(sel);
+
+    if (!focus) return {};
+
+    return [this, focus]() { set_focus(focus); };
+}
+
+Plot::ProbeResult SegmentPlot::handle_probe(glm::vec3 const& probe_point) {
+    // probes are frequent, and come in on a worker thread; only decimated
+    // lines care, and they refocus on the main thread
+    if (!m_decimate) return {};
+
+    // this much around the probe is refined, in the physical domain
+    auto focus = probe_focus(probe_point, .1);
+
+    QMetaObject::invokeMethod(
+        this, [this, focus]() { set_focus(focus); }, Qt::QueuedConnection);
+
+    return {};
+}
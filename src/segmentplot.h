@@ -0,0 +1,104 @@
+#ifndef SEGMENTPLOT_H
+#define SEGMENTPLOT_H
+
+#include "instancepages.h"
+#include "linepyramid.h"
+#include "plot.h"
+#include "plotty.h"
+#include "segmentcore.h"
+
+#include <memory>
+#include <optional>
+
+enum class SegmentStyle {
+    Tubes, // a tube glyph instance per segment
+    Lines, // a single line mesh, one pixel wide
+};
+
+///
+/// \brief Common code for plots of line segments.
+///
+/// Segments are drawn as tubes, or, above the line threshold, as a line mesh;
+/// a plot can also be set to one or the other.
+///
+/// Polylines with more vertices than the vertex budget are drawn from a
+/// decimation pyramid instead. The last selected or probed region is kept in
+/// more detail than the rest.
+///
+class SegmentPlot : public Plot {
+    SegmentTopology m_topology;
+    QString         m_name;
+
+    // shared with background rebuilds, so never changed in place
+    std::shared_ptr<SegmentData const> m_data;
+
+    SegmentStyle                m_style = SegmentStyle::Tubes;
+    std::optional<SegmentStyle> m_style_override;
+
+    InstanceArena m_instances;
+    InstancePages m_pages;
+
+    noo::MeshTPtr   m_line_mesh;
+    noo::ObjectTPtr m_line_obj;
+
+    size_t                     m_vertex_budget = 0; // 0 for no limit
+    std::optional<Bounds>      m_focus;
+    std::optional<LinePyramid> m_pyramid;   // built on first use
+    bool                       m_decimate      = false;
+    bool                       m_focus_changed = false;
+
+    std::shared_ptr<SegmentData const> m_decimated; // if m_decimate
+
+    std::shared_ptr<SegmentData const> const& shown() const {
+        return m_decimate ? m_decimated : m_data;
+    }
+
+    SegmentStyle wanted_style() const;
+
+    bool update_decimation();
+    void set_focus(std::optional<Bounds>);
+
+    void rebuild();
+
+    /// \brief Switch to the tube mesh for the current domain, if it changed
+    void update_glyph();
+
+    /// \brief Build tubes on the task pool; a newer build supersedes it
+    void rebuild_instances();
+    void rebuild_lines();
+
+protected:
+    void flush_data() override;
+
+    SegmentPlot(Plotty&                    host,
+                int64_t                    id,
+                SegmentTopology            topology,
+                QString                    kind,
+                std::span<float const>     px,
+                std::span<float const>     py,
+                std::span<float const>     pz,
+                std::span<glm::vec3 const> colors,
+                std::span<glm::vec2 const> scales);
+
+public:
+    ~SegmentPlot() override;
+
+    /// \brief The number of segments drawn
+    size_t segment_count() const;
+
+    /// \brief Force a style, or pick one from the segment count if not set
+    void set_style(std::optional<SegmentStyle>);
+
+    /// \brief Limit the vertices drawn for a polyline. Zero for no limit.
+    void set_vertex_budget(size_t);
+
+    void domain_updated(Domain const&) override;
+
+    std::function<void()> prepare_selection(SpatialSelection const&) override;
+
+    ProbeResult handle_probe(glm::vec3 const&) override;
+
+    bool owns_object(noo::ObjectTPtr const&) const override;
+};
+
+#endif // SEGMENTPLOT_H
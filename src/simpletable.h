@@ -5,7 +5,12 @@
 
 #include <QObject>
 
+#include <algorithm>
+#include <functional>
+#include <span>
+#include <stdexcept>
 #include <unordered_set>
+#include <vector>
 
 
 struct LoadTableColumn {
@@ -72,15 +77,31 @@ decode_array_at(std::tuple<Ts...>& tuple, size_t row, QCborArray const& array) {
 }
 
 
+///
+/// \brief Remove all rows flagged in dead, keeping the order of the rest.
+///
+/// Rows before first are known to be alive and are not touched.
+///
 template <size_t I = 0, class... Ts>
-constexpr void delete_at(std::tuple<Ts...>& tuple, size_t row) {
+constexpr void compact_all(std::tuple<Ts...>&       tuple,
+                           std::span<uint8_t const> dead,
+                           size_t                   first) {
     if constexpr (I == sizeof...(Ts)) {
         return;
     } else {
         auto& l = std::get<I>(tuple);
-        l.erase(l.begin() + row);
 
-        delete_at<I + 1>(tuple, row);
+        size_t write = first;
+
+        for (size_t read = first; read < size_t(l.size()); read++) {
+            if (dead[read]) continue;
+            if (write != read) l[write] = std::move(l[read]);
+            write++;
+        }
+
+        l.resize(write);
+
+        compact_all<I + 1>(tuple, dead, first);
     }
 }
 
@@ -98,23 +119,29 @@ constexpr void clear_all(std::tuple<Ts...>& tuple) {
 
 template <class... Args>
 class SpecificTable : public noo::ServerTableDelegate {
+public:
+    using TupleType = std::tuple<QVector<Args>...>;
+
+private:
     QString         m_name;
     QStringList     m_headers;
     QVector<qint64> m_key_list;
 
-    using TupleType = std::tuple<QVector<Args>...>;
     TupleType m_data_list;
 
-    std::unordered_map<quint64, quint64> m_key_to_row_map;
+    // Keys come from a monotonic counter, so key - m_key_base indexes this
+    // directly. Deleted keys are marked with -1; a leading run of them is
+    // dropped by moving the base.
+    std::vector<int64_t> m_key_to_row;
+    size_t               m_key_base = 0;
 
     static constexpr inline size_t m_num_cols = std::tuple_size_v<TupleType>;
 
     QHash<QString, noo::Selection> m_selections;
 
-    size_t m_counter = 0;
+    std::function<void(std::span<int64_t const>)> m_retire_observer;
 
-    QCborArray m_cached_keys;
-    QCborArray m_cached_rows;
+    size_t m_counter = 0;
 
     uint64_t next_counter() {
         auto save = m_counter;
@@ -122,23 +149,11 @@ class SpecificTable : public noo::ServerTableDelegate {
         return save;
     }
 
-    void rebuild_cache() {
-        m_cached_keys.clear();
-        m_cached_rows.clear();
-
-        for (auto k : m_key_list) {
-            m_cached_keys << k;
-        }
-
-        auto num_rows = m_key_list.size();
-
-        for (auto ri = 0; ri < num_rows; ri++) {
-            QCborArray row;
-
-            fill_array(m_data_list, ri, row);
-
-            m_cached_rows << row;
-        }
+    int64_t add_key_for_row(int64_t row) {
+        auto key = next_counter();
+        m_key_list << key;
+        m_key_to_row.push_back(row);
+        return key;
     }
 
     QCborArray get_row(int i) const {
@@ -153,19 +168,14 @@ class SpecificTable : public noo::ServerTableDelegate {
         QCborArray ret_rows;
 
         for (int i = 0; i < new_rows.size(); i++) {
-            auto key = next_counter();
-            m_key_list << key;
-            m_cached_keys << (qint64)key;
-            ret_keys << (qint64)key;
-
             auto row = std::get<0>(m_data_list).size();
 
-            m_key_to_row_map[key] = row;
+            auto key = add_key_for_row(row);
+            ret_keys << (qint64)key;
 
             decode_array(m_data_list, new_rows[i].toArray());
 
-            m_cached_rows << get_row(row);
-            ret_rows << m_cached_rows.last();
+            ret_rows << get_row(row);
         }
 
         return { ret_keys, ret_rows };
@@ -220,20 +230,92 @@ public:
         common_insert(datas);
     }
 
+    ///
+    /// \brief Construct from already decoded columns.
+    ///
+    /// The columns are moved in without any conversion. Any column shorter
+    /// than the first is padded with default values, any longer is truncated.
+    ///
+    SpecificTable(QString name, QStringList headers, TupleType&& columns)
+        : noo::ServerTableDelegate(nullptr),
+          m_name(std::move(name)),
+          m_headers(std::move(headers)),
+          m_data_list(std::move(columns)) {
+
+        while (m_headers.size() > m_num_cols) {
+            m_headers.pop_back();
+        }
+        while (m_headers.size() < m_num_cols) {
+            m_headers << QString();
+        }
+
+        auto const num_rows = std::get<0>(m_data_list).size();
+
+        std::apply([num_rows](auto&... c) { (c.resize(num_rows), ...); },
+                   m_data_list);
+
+        m_key_list.reserve(num_rows);
+        m_key_to_row.reserve(num_rows);
+
+        for (qsizetype row = 0; row < num_rows; row++) {
+            add_key_for_row(row);
+        }
+    }
+
     auto name() const { return m_name; }
 
-    auto const& columns() { return m_data_list; }
+    ///
+    /// \brief Set a function to be told of rows that are about to be
+    /// overwritten or deleted.
+    ///
+    /// It is called with row indices, while the rows still hold their old
+    /// values. Resets are not reported.
+    ///
+    void set_retire_observer(
+        std::function<void(std::span<int64_t const> rows)> observer) {
+        m_retire_observer = std::move(observer);
+    }
+
+    auto const& columns() const { return m_data_list; }
 
     auto get_all_keys() const { return std::span(m_key_list); }
 
+    /// \brief Get the row of a key, or -1 if the key is not in the table.
+    int64_t row_of(int64_t key) const {
+        if (key < int64_t(m_key_base)) return -1;
+
+        auto slot = size_t(key) - m_key_base;
+
+        if (slot >= m_key_to_row.size()) return -1;
+
+        return m_key_to_row[slot];
+    }
+
     template <size_t I>
     auto get_column_at_key(int key) const {
-        return std::get<I>(m_data_list)[m_key_to_row_map.at(key)];
+        auto row = row_of(key);
+
+        if (row < 0) throw std::out_of_range("Unknown table key");
+
+        return std::get<I>(m_data_list)[row];
     }
 
     QStringList get_headers() override { return m_headers; }
     std::pair<QCborArray, QCborArray> get_all_data() override {
-        return { m_cached_keys, m_cached_rows };
+        // Rows are encoded from the typed columns on request. This is only
+        // needed when a client subscribes, so we do not keep a CBOR copy.
+        QCborArray keys;
+        QCborArray rows;
+
+        for (auto k : m_key_list) {
+            keys << k;
+        }
+
+        for (qsizetype ri = 0; ri < m_key_list.size(); ri++) {
+            rows << get_row(ri);
+        }
+
+        return { keys, rows };
     }
     QList<noo::Selection> get_all_selections() override {
         return m_selections.values();
@@ -253,13 +335,20 @@ public:
 
         QCborArray fixed_rows;
 
-        for (int i = 0; i < raw_rows.size(); i++) {
-            auto actual_row_iter =
-                m_key_to_row_map.find(raw_keys[i].toInteger(-1));
+        auto const count = std::min(raw_keys.size(), raw_rows.size());
 
-            if (actual_row_iter == m_key_to_row_map.end()) continue;
+        std::vector<int64_t> actual_rows(count);
 
-            auto actual_row = actual_row_iter->second;
+        for (qsizetype i = 0; i < count; i++) {
+            actual_rows[i] = row_of(raw_keys[i].toInteger(-1));
+        }
+
+        if (m_retire_observer) m_retire_observer(actual_rows);
+
+        for (qsizetype i = 0; i < count; i++) {
+            auto actual_row = actual_rows[i];
+
+            if (actual_row < 0) continue;
 
             auto raw_row = raw_rows[i].toArray();
 
@@ -271,8 +360,6 @@ public:
                 raw_row.pop_back();
             }
 
-            m_cached_rows[actual_row] = raw_row;
-
             decode_array_at(m_data_list, actual_row, raw_row);
 
             fixed_rows << raw_row;
@@ -282,41 +369,71 @@ public:
     }
 
     void handle_deletion(QCborArray const& keys) override {
-        // take array, sort, and process in reverse to avoid movement issues
-
         auto list = noo::coerce_to_int_list(keys.toCborValue());
 
-        // turn into a row list
+        auto const num_rows = size_t(m_key_list.size());
 
-        std::vector<int64_t> row_ids;
+        // flag the rows to drop, and tombstone their keys
+        std::vector<uint8_t> dead(num_rows, 0);
+        std::vector<int64_t> dead_rows;
+        size_t               first = num_rows;
+        QCborArray           deleted_keys;
 
         for (auto key : list) {
-            row_ids.push_back(m_key_to_row_map[key]);
+            auto row = row_of(key);
+
+            if (row < 0) continue; // unknown, or already gone
+
+            dead[row] = 1;
+            first     = std::min(first, size_t(row));
+
+            m_key_to_row[key - m_key_base] = -1;
+
+            dead_rows.push_back(row);
+            deleted_keys << key;
         }
 
-        std::sort(row_ids.begin(), row_ids.end());
-        row_ids.erase(std::unique(row_ids.begin(), row_ids.end()),
-                      row_ids.end());
+        if (first == num_rows) return;
+
+        if (m_retire_observer) m_retire_observer(dead_rows);
+
+        // one stable pass over every column, and then the keys
+        compact_all(m_data_list, dead, first);
+
+        size_t write = first;
 
-        // this is a horrible way to do this;
-        for (auto iter = row_ids.rbegin(); iter != row_ids.rend(); ++iter) {
-            size_t row = *iter;
+        for (size_t read = first; read < num_rows; read++) {
+            if (dead[read]) continue;
 
-            m_cached_keys.erase(m_cached_keys.begin() + row);
-            m_cached_rows.erase(m_cached_rows.begin() + row);
+            auto key = m_key_list[read];
 
-            m_key_list.erase(m_key_list.begin() + row);
+            m_key_list[write]              = key;
+            m_key_to_row[key - m_key_base] = write;
 
-            delete_at(m_data_list, row);
+            write++;
         }
 
-        emit table_row_deleted(keys);
+        m_key_list.resize(write);
+
+        // streaming tables drop their oldest keys; forget those, so the map
+        // only spans keys from the oldest live one on
+        auto live = std::find_if(m_key_to_row.begin(),
+                                 m_key_to_row.end(),
+                                 [](int64_t r) { return r >= 0; });
+
+        m_key_base += size_t(live - m_key_to_row.begin());
+        m_key_to_row.erase(m_key_to_row.begin(), live);
+
+        emit table_row_deleted(deleted_keys);
     }
 
     void handle_reset() override {
         clear_all(m_data_list);
         m_key_list.clear();
-        rebuild_cache();
+
+        // keys are never reused, so everything before the counter is dead
+        m_key_to_row.clear();
+        m_key_base = m_counter;
 
         emit table_reset();
     }
@@ -0,0 +1,346 @@
+#include "spatialindex.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+size_t const leaf_size = 32;
+
+// the tail may hold this many rows before we rebuild, at minimum
+size_t const min_tail_size = 4096;
+
+enum class Overlap { Outside, Partial, Inside };
+
+} // namespace
+
+void SpatialIndex::invalidate() {
+    m_valid = false;
+}
+
+void SpatialIndex::update_rows(std::span<int64_t const> rows) {
+    if (!m_valid) return;
+
+    for (auto row : rows) {
+        // rows in the tail are scanned anyway
+        if (row < 0 or size_t(row) >= m_id_of_row.size()) continue;
+
+        auto id = m_id_of_row[row];
+
+        if (m_moved[id]) continue;
+
+        m_moved[id] = 1;
+        m_moved_ids.push_back(id);
+    }
+}
+
+void SpatialIndex::remove_rows(std::span<int64_t const> rows) {
+    if (!m_valid) return;
+
+    std::vector<int64_t> gone(rows.begin(), rows.end());
+
+    std::sort(gone.begin(), gone.end());
+    gone.erase(std::unique(gone.begin(), gone.end()), gone.end());
+
+    // renumber the rows the tree covers, dropping the deleted ones
+    auto   next_gone = std::lower_bound(gone.begin(), gone.end(), 0);
+    size_t kept      = 0;
+
+    for (size_t row = 0; row < m_id_of_row.size(); row++) {
+        auto id = m_id_of_row[row];
+
+        if (next_gone != gone.end() and *next_gone == int64_t(row)) {
+            ++next_gone;
+
+            m_row_of_id[id] = -1;
+            m_deleted++;
+            continue;
+        }
+
+        m_row_of_id[id]   = kept;
+        m_id_of_row[kept] = id;
+        kept++;
+    }
+
+    m_id_of_row.resize(kept);
+}
+
+void SpatialIndex::ensure(Columns const& c) {
+    auto const count = c.size();
+    auto const live  = m_id_of_row.size();
+
+    if (m_valid and count >= live) {
+        // everything the tree does not answer for on its own
+        auto stale = (count - live) + m_moved_ids.size() + m_deleted;
+
+        if (stale <= std::max(min_tail_size, m_indexed / 8)) return;
+    }
+
+    build(c);
+}
+
+void SpatialIndex::build(Columns const& c) {
+    auto const count = c.size();
+
+    m_order.resize(count);
+    std::iota(m_order.begin(), m_order.end(), 0u);
+
+    m_row_of_id.resize(count);
+    std::iota(m_row_of_id.begin(), m_row_of_id.end(), 0);
+
+    m_id_of_row.resize(count);
+    std::iota(m_id_of_row.begin(), m_id_of_row.end(), 0u);
+
+    m_moved.assign(count, 0);
+    m_moved_ids.clear();
+
+    m_nodes.clear();
+    m_indexed = count;
+    m_deleted = 0;
+    m_valid   = true;
+
+    if (count == 0) return;
+
+    m_nodes.reserve(2 * (count / leaf_size) + 1);
+
+    build_node(c, 0, count);
+}
+
+uint32_t SpatialIndex::build_node(Columns const& c, uint32_t begin, uint32_t end) {
+    uint32_t id = m_nodes.size();
+    m_nodes.emplace_back();
+
+    Node node {
+        .lo    = glm::vec3(std::numeric_limits<float>::max()),
+        .hi    = glm::vec3(std::numeric_limits<float>::lowest()),
+        .begin = begin,
+        .end   = end,
+    };
+
+    for (auto i = begin; i < end; i++) {
+        auto p  = c.at(m_order[i]);
+        node.lo = glm::min(node.lo, p);
+        node.hi = glm::max(node.hi, p);
+    }
+
+    if (end - begin > leaf_size) {
+        auto ext = node.hi - node.lo;
+
+        int axis = (ext.x >= ext.y and ext.x >= ext.z) ? 0
+                   : (ext.y >= ext.z)                  ? 1
+                                                       : 2;
+
+        auto const& col = axis == 0 ? c.px : axis == 1 ? c.py : c.pz;
+
+        auto mid = begin + (end - begin) / 2;
+
+        std::nth_element(m_order.begin() + begin,
+                         m_order.begin() + mid,
+                         m_order.begin() + end,
+                         [&col](uint32_t a, uint32_t b) {
+                             return col[a] < col[b];
+                         });
+
+        node.left  = build_node(c, begin, mid);
+        node.right = build_node(c, mid, end);
+    }
+
+    // children may have reallocated the node list
+    m_nodes[id] = node;
+
+    return id;
+}
+
+template <class Classify, class Test>
+void SpatialIndex::collect(Columns const&        c,
+                           Classify&&            classify,
+                           Test&&                test,
+                           std::vector<int64_t>& out) const {
+    if (m_valid and !m_nodes.empty()) {
+        std::vector<uint32_t> stack = { 0 };
+
+        while (!stack.empty()) {
+            auto const& n = m_nodes[stack.back()];
+            stack.pop_back();
+
+            switch (classify(n.lo, n.hi)) {
+            case Overlap::Outside: continue;
+            case Overlap::Inside:
+                for (auto i = n.begin; i < n.end; i++) {
+                    auto row = tree_row(m_order[i]);
+                    if (row >= 0) out.push_back(row);
+                }
+                continue;
+            case Overlap::Partial: break;
+            }
+
+            if (n.left == 0) {
+                for (auto i = n.begin; i < n.end; i++) {
+                    auto row = tree_row(m_order[i]);
+                    if (row >= 0 and test(c.at(row))) out.push_back(row);
+                }
+                continue;
+            }
+
+            stack.push_back(n.right);
+            stack.push_back(n.left);
+        }
+
+        for (auto id : m_moved_ids) {
+            auto row = m_row_of_id[id];
+            if (row >= 0 and test(c.at(row))) out.push_back(row);
+        }
+    }
+
+    auto const tail_begin = indexed_count();
+
+    for (size_t row = tail_begin; row < c.size(); row++) {
+        if (test(c.at(row))) out.push_back(row);
+    }
+}
+
+void SpatialIndex::query_box(Columns const&        c,
+                             glm::vec3             lo,
+                             glm::vec3             hi,
+                             std::vector<int64_t>& out) const {
+    auto classify = [lo, hi](glm::vec3 const& nlo, glm::vec3 const& nhi) {
+        if (glm::any(glm::lessThan(nhi, lo))) return Overlap::Outside;
+        if (glm::any(glm::greaterThan(nlo, hi))) return Overlap::Outside;
+
+        if (glm::all(glm::greaterThanEqual(nlo, lo)) and
+            glm::all(glm::lessThanEqual(nhi, hi))) {
+            return Overlap::Inside;
+        }
+
+        return Overlap::Partial;
+    };
+
+    auto test = [lo, hi](glm::vec3 const& p) {
+        return glm::all(glm::greaterThanEqual(p, lo)) and
+               glm::all(glm::lessThanEqual(p, hi));
+    };
+
+    collect(c, classify, test, out);
+}
+
+void SpatialIndex::query_sphere(Columns const&        c,
+                                glm::vec3             center,
+                                float                 radius,
+                                std::vector<int64_t>& out,
+                                glm::vec3             metric) const {
+    auto const r2 = radius * radius;
+
+    metric = glm::abs(metric);
+
+    auto classify = [center, r2, metric](glm::vec3 const& nlo,
+                                         glm::vec3 const& nhi) {
+        auto near = (glm::clamp(center, nlo, nhi) - center) * metric;
+
+        if (glm::dot(near, near) > r2) return Overlap::Outside;
+
+        auto far = glm::max(glm::abs(nlo - center), glm::abs(nhi - center)) *
+                   metric;
+
+        if (glm::dot(far, far) <= r2) return Overlap::Inside;
+
+        return Overlap::Partial;
+    };
+
+    auto test = [center, r2, metric](glm::vec3 const& p) {
+        auto d = (p - center) * metric;
+        return glm::dot(d, d) <= r2;
+    };
+
+    collect(c, classify, test, out);
+}
+
+void SpatialIndex::query_halfspace(Columns const&        c,
+                                   glm::vec3             point,
+                                   glm::vec3             normal,
+                                   std::vector<int64_t>& out) const {
+    auto classify = [point, normal](glm::vec3 const& nlo,
+                                    glm::vec3 const& nhi) {
+        auto center = (nlo + nhi) * .5f;
+        auto half   = (nhi - nlo) * .5f;
+
+        auto d      = glm::dot(center - point, normal);
+        auto extent = glm::dot(half, glm::abs(normal));
+
+        if (d - extent > 0) return Overlap::Inside;
+        if (d + extent <= 0) return Overlap::Outside;
+
+        return Overlap::Partial;
+    };
+
+    auto test = [point, normal](glm::vec3 const& p) {
+        return glm::dot(p - point, normal) > 0;
+    };
+
+    collect(c, classify, test, out);
+}
+
+int64_t SpatialIndex::query_nearest(Columns const& c,
+                                    glm::vec3      p,
+                                    float          radius,
+                                    glm::vec3      metric) const {
+    float   best_d2  = radius * radius; // others must be less than this
+    int64_t best_row = -1;
+
+    auto dist2 = [p, metric](glm::vec3 const& q) {
+        auto d = (q - p) * metric;
+        return glm::dot(d, d);
+    };
+
+    auto consider = [&](size_t row) {
+        auto d2 = dist2(c.at(row));
+        if (d2 >= best_d2) return;
+        best_d2  = d2;
+        best_row = row;
+    };
+
+    if (m_valid and !m_nodes.empty()) {
+        std::vector<uint32_t> stack = { 0 };
+
+        while (!stack.empty()) {
+            auto const& n = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (dist2(glm::clamp(p, n.lo, n.hi)) >= best_d2) continue;
+
+            if (n.left == 0) {
+                for (auto i = n.begin; i < n.end; i++) {
+                    auto row = tree_row(m_order[i]);
+                    if (row >= 0) consider(row);
+                }
+                continue;
+            }
+
+            // visit the nearer child first, so it is on top of the stack
+            auto const& l = m_nodes[n.left];
+            auto const& r = m_nodes[n.right];
+
+            auto dl = dist2(glm::clamp(p, l.lo, l.hi));
+            auto dr = dist2(glm::clamp(p, r.lo, r.hi));
+
+            if (dl <= dr) {
+                stack.push_back(n.right);
+                stack.push_back(n.left);
+            } else {
+                stack.push_back(n.left);
+                stack.push_back(n.right);
+            }
+        }
+
+        for (auto id : m_moved_ids) {
+            auto row = m_row_of_id[id];
+            if (row >= 0) consider(row);
+        }
+    }
+
+    for (size_t row = indexed_count(); row < c.size(); row++) {
+        consider(row);
+    }
+
+    return best_row;
+}
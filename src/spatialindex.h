@@ -0,0 +1,127 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include "noo_include_glm.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+///
+/// \brief A k-d tree over the rows of three position columns.
+///
+/// The tree stores row indices, not positions, so the columns have to be
+/// handed in to every call. Rows appended after the last build are kept in an
+/// unindexed tail that is scanned linearly. Indexed rows that are rewritten
+/// are taken out of the tree and scanned from a side list, and deleted rows
+/// are left in the tree as tombstones, with the remaining rows renumbered.
+/// Once the tail, side list and tombstones grow past a fraction of the tree,
+/// the next ensure() rebuilds.
+///
+class SpatialIndex {
+public:
+    struct Columns {
+        std::span<float const> px, py, pz;
+
+        size_t    size() const { return px.size(); }
+        glm::vec3 at(size_t row) const { return { px[row], py[row], pz[row] }; }
+    };
+
+    /// \brief Mark the tree as stale. It is rebuilt on the next ensure().
+    void invalidate();
+
+    /// \brief The number of rows covered by the tree, not counting the tail.
+    size_t indexed_count() const { return m_valid ? m_id_of_row.size() : 0; }
+
+    /// \brief Note rows whose positions were rewritten in place.
+    void update_rows(std::span<int64_t const> rows);
+
+    ///
+    /// \brief Note rows that were deleted, numbered as before the delete.
+    ///
+    /// Later rows are renumbered to close the gaps.
+    ///
+    void remove_rows(std::span<int64_t const> rows);
+
+    /// \brief Bring the index up to date with the given columns.
+    void ensure(Columns const&);
+
+    /// \brief Append all rows inside the box [lo, hi] to out.
+    void query_box(Columns const&,
+                   glm::vec3             lo,
+                   glm::vec3             hi,
+                   std::vector<int64_t>& out) const;
+
+    ///
+    /// \brief Append all rows within radius of center to out.
+    ///
+    /// Distances are scaled by metric, as in query_nearest, so the sphere may
+    /// be an ellipsoid in the space of the columns.
+    ///
+    void query_sphere(Columns const&,
+                      glm::vec3             center,
+                      float                 radius,
+                      std::vector<int64_t>& out,
+                      glm::vec3             metric = glm::vec3(1)) const;
+
+    /// \brief Append all rows strictly on the side of the plane the normal
+    /// points to.
+    void query_halfspace(Columns const&,
+                         glm::vec3             point,
+                         glm::vec3             normal,
+                         std::vector<int64_t>& out) const;
+
+    ///
+    /// \brief Find the row closest to p, closer than radius.
+    ///
+    /// Distances are measured after scaling each axis by metric, which lets
+    /// callers search in a space other than the one the columns live in.
+    ///
+    /// \returns The row, or -1 if nothing is close enough.
+    ///
+    int64_t query_nearest(Columns const&,
+                          glm::vec3 p,
+                          float     radius,
+                          glm::vec3 metric = glm::vec3(1)) const;
+
+private:
+    struct Node {
+        glm::vec3 lo, hi;
+        uint32_t  begin, end; // range in m_order
+        uint32_t  left  = 0;  // 0 means this is a leaf; the root is never a
+        uint32_t  right = 0;  // child
+    };
+
+    std::vector<Node>     m_nodes;
+    std::vector<uint32_t> m_order; // ids, which are rows as of the build
+
+    // the current row of each id, or -1 once deleted, and the other way
+    // around for the rows the tree covers
+    std::vector<int64_t>  m_row_of_id;
+    std::vector<uint32_t> m_id_of_row;
+
+    // ids rewritten since the build; the tree skips them, and queries scan
+    // them instead
+    std::vector<uint8_t>  m_moved;
+    std::vector<uint32_t> m_moved_ids;
+
+    size_t m_indexed = 0; // rows at the build
+    size_t m_deleted = 0;
+    bool   m_valid   = false;
+
+    /// \brief The current row of an id, or -1 if it is not in the tree
+    int64_t tree_row(uint32_t id) const {
+        return m_moved[id] ? -1 : m_row_of_id[id];
+    }
+
+    void     build(Columns const&);
+    uint32_t build_node(Columns const&, uint32_t begin, uint32_t end);
+
+    template <class Classify, class Test>
+    void collect(Columns const&,
+                 Classify&&            classify,
+                 Test&&                test,
+                 std::vector<int64_t>& out) const;
+};
+
+#endif // SPATIALINDEX_H
@@ -246,7 +246,7 @@ void TablePlot::rebuild_cache(size_t from, size_t count) {
     rebuild_instances(from, count);
     // this is kinda nasty, as we are thus double rebuilding instances...
 
-    m_host->domain()->ask_update_input_bounds(new_min, new_max);
+    m_host->domain()->update_plot_bounds(m_plot_id, { new_min, new_max });
 }
 
 void TablePlot::set_clear() {
@@ -0,0 +1,136 @@
+#include "taskpool.h"
+
+#include <QDebug>
+
+namespace {
+
+// the pool the current thread works for, if any, and the index of its queue
+// there; t_index means nothing unless t_pool is set
+thread_local TaskPool const* t_pool  = nullptr;
+thread_local size_t          t_index = 0;
+
+} // namespace
+
+TaskPool::TaskPool(size_t num_threads) {
+    m_queues.reserve(num_threads);
+
+    for (size_t i = 0; i < num_threads; i++) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+
+    m_threads.reserve(num_threads);
+
+    for (size_t i = 0; i < num_threads; i++) {
+        m_threads.emplace_back([this, i]() { worker_main(i); });
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard lock(m_sleep_lock);
+        m_stop = true;
+    }
+
+    m_wake.notify_all();
+
+    for (auto& t : m_threads) {
+        t.join();
+    }
+}
+
+TaskPool& TaskPool::global() {
+    // the calling thread usually helps out, so leave a core for it
+    static TaskPool pool(
+        std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void TaskPool::report_error(std::exception_ptr error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (std::exception const& e) {
+        qWarning() << "Background task failed:" << e.what();
+    } catch (...) { qWarning() << "Background task failed"; }
+}
+
+void TaskPool::submit(Task task) {
+    if (m_threads.empty()) {
+        task();
+        return;
+    }
+
+    // workers push to their own queue, everyone else spreads the load
+    size_t target = (t_pool == this)
+                        ? t_index
+                        : m_next_inject.fetch_add(1) % m_queues.size();
+
+    {
+        auto& q = *m_queues[target];
+
+        std::lock_guard lock(q.lock);
+        q.tasks.push_back(std::move(task));
+    }
+
+    m_pending.fetch_add(1);
+
+    {
+        // taking the lock makes sure a worker about to sleep sees the task
+        std::lock_guard lock(m_sleep_lock);
+    }
+
+    m_wake.notify_one();
+}
+
+bool TaskPool::try_pop(size_t home, Task& out) {
+    {
+        auto& q = *m_queues[home];
+
+        std::lock_guard lock(q.lock);
+
+        if (!q.tasks.empty()) {
+            out = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < m_queues.size(); i++) {
+        auto& q = *m_queues[(home + i) % m_queues.size()];
+
+        std::lock_guard lock(q.lock);
+
+        if (!q.tasks.empty()) {
+            out = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TaskPool::worker_main(size_t index) {
+    t_pool  = this;
+    t_index = index;
+
+    while (true) {
+        Task task;
+
+        if (try_pop(index, task)) {
+            m_pending.fetch_sub(1);
+
+            // an exception leaving the thread would take the process down
+            try {
+                task();
+            } catch (...) { report_error(std::current_exception()); }
+
+            continue;
+        }
+
+        std::unique_lock lock(m_sleep_lock);
+
+        m_wake.wait(lock, [this]() { return m_stop or m_pending.load() > 0; });
+
+        if (m_stop) return;
+    }
+}
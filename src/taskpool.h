@@ -0,0 +1,242 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+///
+/// \brief A work-stealing thread pool.
+///
+/// Each worker owns a deque. A worker runs its own newest task first, and
+/// when it runs dry, steals the oldest task of another worker. Tasks submitted
+/// from outside the pool are spread over the workers round-robin.
+///
+/// parallel_for has the caller claim chunks alongside the workers, so it
+/// never waits on work that has not started, and can be nested freely.
+///
+class TaskPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit TaskPool(size_t num_threads);
+    ~TaskPool();
+
+    TaskPool(TaskPool const&)            = delete;
+    TaskPool& operator=(TaskPool const&) = delete;
+
+    /// \brief The pool shared by the whole application.
+    static TaskPool& global();
+
+    size_t thread_count() const { return m_threads.size(); }
+
+    void submit(Task);
+
+    ///
+    /// \brief Call f(chunk_begin, chunk_end) over [begin, end) in chunks of
+    /// grain, and wait for all of them.
+    ///
+    /// The first exception thrown by f is rethrown here.
+    ///
+    template <class Function>
+    void parallel_for(size_t begin, size_t end, size_t grain, Function&& f);
+
+    /// \brief Run f on the pool, and get a future for the result.
+    template <class Function>
+    auto async(Function&& f) -> std::future<std::invoke_result_t<Function>>;
+
+    ///
+    /// \brief Run f on the pool, then call then(result) on the main thread.
+    ///
+    /// If f throws, on_error is called with the exception on the main thread
+    /// instead. If context has been destroyed by the time f is done, neither
+    /// is called.
+    ///
+    template <class Function, class Then, class OnError>
+    void run_then(QObject*   context,
+                  Function&& f,
+                  Then&&     then,
+                  OnError&&  on_error);
+
+    /// \brief As above, but exceptions from f are logged and dropped.
+    template <class Function, class Then>
+    void run_then(QObject* context, Function&& f, Then&& then);
+
+    /// \brief Log an exception that escaped a task
+    static void report_error(std::exception_ptr);
+
+private:
+    struct Queue {
+        std::mutex       lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread>            m_threads;
+
+    std::atomic<size_t> m_pending     = 0;
+    std::atomic<size_t> m_next_inject = 0;
+    bool                m_stop        = false;
+
+    std::mutex              m_sleep_lock;
+    std::condition_variable m_wake;
+
+    void worker_main(size_t index);
+    bool try_pop(size_t home, Task& out);
+};
+
+// =============================================================================
+
+template <class Function>
+void TaskPool::parallel_for(size_t     begin,
+                            size_t     end,
+                            size_t     grain,
+                            Function&& f) {
+    if (end <= begin) return;
+
+    grain = std::max<size_t>(grain, 1);
+
+    size_t const num_chunks = (end - begin + grain - 1) / grain;
+
+    if (num_chunks == 1 or thread_count() == 0) {
+        f(begin, end);
+        return;
+    }
+
+    struct State {
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> done = 0;
+        std::mutex          error_lock;
+        std::exception_ptr  error;
+    };
+
+    auto state = std::make_shared<State>();
+
+    // Helpers that start after every chunk is claimed return without touching
+    // f, so it is fine for them to outlive this call.
+    auto work = [state, &f, begin, end, grain, num_chunks]() {
+        while (true) {
+            auto c = state->next.fetch_add(1);
+
+            if (c >= num_chunks) return;
+
+            auto b = begin + c * grain;
+            auto e = std::min(end, b + grain);
+
+            try {
+                f(b, e);
+            } catch (...) {
+                std::lock_guard lock(state->error_lock);
+                if (!state->error) state->error = std::current_exception();
+            }
+
+            auto d = state->done.fetch_add(1, std::memory_order_release);
+
+            if (d + 1 == num_chunks) state->done.notify_all();
+        }
+    };
+
+    auto const num_helpers = std::min(num_chunks - 1, thread_count());
+
+    for (size_t i = 0; i < num_helpers; i++) {
+        submit(work);
+    }
+
+    work();
+
+    // anything left is already running on another thread; sleep until the
+    // last chunk finishes rather than spin
+    while (true) {
+        auto d = state->done.load(std::memory_order_acquire);
+
+        if (d >= num_chunks) break;
+
+        state->done.wait(d, std::memory_order_acquire);
+    }
+
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+template <class Function>
+auto TaskPool::async(Function&& f)
+    -> std::future<std::invoke_result_t<Function>> {
+    using Result = std::invoke_result_t<Function>;
+
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<Function>(f));
+
+    auto future = task->get_future();
+
+    submit([task]() { (*task)(); });
+
+    return future;
+}
+
+template <class Function, class Then, class OnError>
+void TaskPool::run_then(QObject*   context,
+                        Function&& f,
+                        Then&&     then,
+                        OnError&&  on_error) {
+    using Result = std::invoke_result_t<Function>;
+
+    // The guard is made here, on the thread that owns context, and only
+    // checked back on that thread.
+    submit([guard    = QPointer<QObject>(context),
+            f        = std::forward<Function>(f),
+            then     = std::forward<Then>(then),
+            on_error = std::forward<OnError>(on_error)]() mutable {
+        std::optional<Result> result;
+        std::exception_ptr    error;
+
+        try {
+            result.emplace(f());
+        } catch (...) { error = std::current_exception(); }
+
+        auto* app = QCoreApplication::instance();
+
+        if (!app) return;
+
+        QMetaObject::invokeMethod(
+            app,
+            [guard,
+             then     = std::move(then),
+             on_error = std::move(on_error),
+             result   = std::move(result),
+             error]() mutable {
+                if (!guard) return;
+
+                if (error) {
+                    on_error(error);
+                    return;
+                }
+
+                then(std::move(*result));
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+template <class Function, class Then>
+void TaskPool::run_then(QObject* context, Function&& f, Then&& then) {
+    run_then(context,
+             std::forward<Function>(f),
+             std::forward<Then>(then),
+             &TaskPool::report_error);
+}
+
+#endif // TASKPOOL_H
@@ -0,0 +1,520 @@
+#include "tiledimageplot.h"
+
+#include "imageplot.h"
+#include "taskpool.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QImageReader>
+
+#include <algorithm>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+// tiles shown at once, at most
+size_t const max_shown_tiles = 64;
+
+// of those, how many are spread evenly before the focus gets the rest
+size_t const context_tiles = max_shown_tiles / 4;
+
+// decodes running at once; fewer means coarse tiles arrive sooner
+size_t const max_in_flight = 4;
+
+// how much around a probe is refined, in the physical domain
+float const probe_focus_radius = .1;
+
+// the header is untrusted; images wider or taller than this are refused
+int const max_image_side = 1 << 20;
+
+} // namespace
+
+///
+/// \brief The encoded image, shared with decode tasks.
+///
+/// Formats that can decode a region on their own, like JPEG, are read tile by
+/// tile. Anything else is decoded once, up front, and tiles are cut from it;
+/// such images are refused if the decode would be larger than max_decoded.
+/// Images wider or taller than max_image_side are refused outright.
+///
+struct TileSource {
+    QByteArray encoded;
+    QImage     decoded; // if the format cannot decode regions
+    QSize      size;
+    int        tile_size   = 512;
+    int        level_count = 1;
+
+    static std::shared_ptr<TileSource const>
+    open(QByteArray data, int tile_size, size_t max_decoded);
+
+    /// \brief The width and height of a tile at a level, in source pixels
+    int64_t span(int level) const {
+        return int64_t(tile_size) << (level_count - 1 - level);
+    }
+
+    int columns(int level) const {
+        return int((size.width() + span(level) - 1) / span(level));
+    }
+
+    int rows(int level) const {
+        return int((size.height() + span(level) - 1) / span(level));
+    }
+
+    QRect rect(TiledImagePlot::TileKey k) const {
+        auto const s = span(k.level);
+
+        auto const x0 = std::min<int64_t>(k.x * s, size.width());
+        auto const y0 = std::min<int64_t>(k.y * s, size.height());
+        auto const x1 = std::min<int64_t>(x0 + s, size.width());
+        auto const y1 = std::min<int64_t>(y0 + s, size.height());
+
+        return QRect(int(x0), int(y0), int(x1 - x0), int(y1 - y0));
+    }
+
+    QImage read_tile(TiledImagePlot::TileKey) const;
+};
+
+std::shared_ptr<TileSource const>
+TileSource::open(QByteArray data, int tile_size, size_t max_decoded) {
+    auto ret       = std::make_shared<TileSource>();
+    ret->encoded   = std::move(data);
+    ret->tile_size = std::clamp(
+        tile_size, PlottyOptions::min_tile_size, PlottyOptions::max_tile_size);
+
+    QBuffer buffer(&ret->encoded);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+
+    bool const can_clip =
+        reader.supportsOption(QImageIOHandler::ClipRect) and
+        reader.supportsOption(QImageIOHandler::ScaledSize);
+
+    // the header is all we trust until we know how much a decode takes
+    ret->size = reader.size();
+
+    if (ret->size.isEmpty()) return nullptr;
+
+    if (ret->size.width() > max_image_side or
+        ret->size.height() > max_image_side) {
+        qWarning() << "Image of" << ret->size << "is larger than"
+                   << max_image_side << "pixels on a side";
+        return nullptr;
+    }
+
+    if (!can_clip) {
+        auto const bytes = size_t(ret->size.width()) * ret->size.height() * 4;
+
+        if (bytes > max_decoded) {
+            qWarning() << "Image of" << ret->size
+                       << "cannot be read in tiles, and is too large to decode"
+                       << "whole";
+            return nullptr;
+        }
+
+        ret->decoded = reader.read();
+        ret->size    = ret->decoded.size();
+    }
+
+    if (ret->size.isEmpty()) return nullptr;
+
+    int64_t const longest = std::max(ret->size.width(), ret->size.height());
+
+    while ((int64_t(ret->tile_size) << (ret->level_count - 1)) < longest) {
+        ret->level_count++;
+    }
+
+    return ret;
+}
+
+QImage TileSource::read_tile(TiledImagePlot::TileKey k) const {
+    auto const r = rect(k);
+    auto const s = span(k.level);
+
+    // shrink by the level, rounding up so edge tiles keep a pixel
+    QSize const out(int((int64_t(r.width()) * tile_size + s - 1) / s),
+                    int((int64_t(r.height()) * tile_size + s - 1) / s));
+
+    if (!decoded.isNull()) {
+        return decoded.copy(r).scaled(
+            out, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    // a fresh buffer per task; the bytes themselves are shared
+    QByteArray bytes = encoded;
+    QBuffer    buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    reader.setClipRect(r);
+    reader.setScaledSize(out);
+
+    return reader.read();
+}
+
+// Tiles =======================================================================
+
+bool TiledImagePlot::tile_exists(TileKey k) const {
+    if (!m_source) return false;
+    if (k.level < 0 or k.level >= m_source->level_count) return false;
+
+    return k.x >= 0 and k.y >= 0 and k.x < m_source->columns(k.level) and
+           k.y < m_source->rows(k.level);
+}
+
+bool TiledImagePlot::tile_loaded(TileKey k) const {
+    auto iter = m_tiles.find(k);
+    return iter != m_tiles.end() and iter->second.loaded;
+}
+
+bool TiledImagePlot::tile_failed(TileKey k) const {
+    auto iter = m_tiles.find(k);
+    return iter != m_tiles.end() and iter->second.failed;
+}
+
+std::vector<TiledImagePlot::TileKey> TiledImagePlot::children(TileKey k) const {
+    std::vector<TileKey> ret;
+
+    for (int dy = 0; dy < 2; dy++) {
+        for (int dx = 0; dx < 2; dx++) {
+            TileKey c { k.level + 1, k.x * 2 + dx, k.y * 2 + dy };
+            if (tile_exists(c)) ret.push_back(c);
+        }
+    }
+
+    return ret;
+}
+
+std::array<glm::vec3, 4> TiledImagePlot::tile_corners(TileKey k) const {
+    auto const r = m_source->rect(k);
+
+    float const w = m_source->size.width();
+    float const h = m_source->size.height();
+
+    // u runs along the top edge, v down the left edge
+    auto at = [&](float u, float v) {
+        return m_top_left + u * (m_bottom_right - m_bottom_left) +
+               v * (m_bottom_left - m_top_left);
+    };
+
+    float const u0 = r.left() / w;
+    float const u1 = (r.right() + 1) / w;
+    float const v0 = r.top() / h;
+    float const v1 = (r.bottom() + 1) / h;
+
+    return { at(u0, v0), at(u0, v1), at(u1, v1), at(u1, v0) };
+}
+
+// Pick the cut to show: first spread evenly, then down into the focus
+void TiledImagePlot::refine() {
+    m_cut = { TileKey {} };
+
+    auto in_focus = [this](TileKey k) {
+        if (!m_focus) return false;
+
+        Bounds b;
+        for (auto const& p : tile_corners(k)) {
+            b.extend(p);
+        }
+
+        return b.intersects(*m_focus);
+    };
+
+    auto expand = [this](size_t limit, auto&& wanted) {
+        while (true) {
+            // the coarsest tile we may split
+            auto best = m_cut.end();
+
+            for (auto iter = m_cut.begin(); iter != m_cut.end(); ++iter) {
+                if (!wanted(*iter)) continue;
+                if (children(*iter).empty()) continue;
+                if (best == m_cut.end() or iter->level < best->level) {
+                    best = iter;
+                }
+            }
+
+            if (best == m_cut.end()) return;
+
+            auto kids = children(*best);
+
+            if (m_cut.size() - 1 + kids.size() > limit) return;
+
+            m_cut.erase(best);
+            m_cut.insert(m_cut.end(), kids.begin(), kids.end());
+        }
+    };
+
+    expand(context_tiles, [](TileKey) { return true; });
+    expand(max_shown_tiles, in_focus);
+}
+
+// Collect loaded tiles that cover the cut under k. Where part of the cut is
+// missing, k stands in for all of it. Returns false if nothing can.
+bool TiledImagePlot::cover(TileKey k, std::vector<TileKey>& out) const {
+    if (std::find(m_cut.begin(), m_cut.end(), k) != m_cut.end()) {
+        if (!tile_loaded(k)) return false;
+        out.push_back(k);
+        return true;
+    }
+
+    auto const mark = out.size();
+
+    bool all = true;
+
+    for (auto const& c : children(k)) {
+        if (!cover(c, out)) {
+            all = false;
+            break;
+        }
+    }
+
+    if (all) return true;
+
+    out.resize(mark);
+
+    if (!tile_loaded(k)) return false;
+
+    out.push_back(k);
+    return true;
+}
+
+void TiledImagePlot::update_display() {
+    std::vector<TileKey> shown;
+
+    if (m_source) cover(TileKey {}, shown);
+
+    std::unordered_set<TileKey, TileKeyHash> shown_set(shown.begin(),
+                                                       shown.end());
+
+    m_clock++;
+
+    for (auto& [k, tile] : m_tiles) {
+        if (!shown_set.contains(k)) {
+            tile.obj.reset();
+            continue;
+        }
+
+        tile.last_used = m_clock;
+
+        if (tile.obj) continue;
+
+        auto name = QString("Tile %1 %2 %3").arg(k.level).arg(k.x).arg(k.y);
+
+        noo::ObjectData object_data;
+        object_data.name       = name;
+        object_data.parent     = m_obj;
+        object_data.definition = noo::ObjectRenderableDefinition {
+            .mesh = tile.mesh,
+        };
+        object_data.transform = glm::mat4(1);
+
+        tile.obj = noo::create_object(m_doc, object_data);
+
+        register_part(tile.obj);
+    }
+
+    for (auto const& k : m_cut) {
+        auto iter = m_tiles.find(k);
+        if (iter != m_tiles.end()) iter->second.last_used = m_clock;
+    }
+}
+
+void TiledImagePlot::request_tiles() {
+    if (!m_source) return;
+
+    // each tile is another texture to send; wait for a frame under the rate
+    // limit
+    if (m_host->rate_limited()) {
+        mark_dirty();
+        return;
+    }
+
+    // the cut, and the ancestors that stand in for it, coarsest first. Tiles
+    // that failed to decode are left out; their ancestors stand in for them.
+    std::vector<TileKey> todo;
+
+    for (auto k : m_cut) {
+        while (true) {
+            if (!tile_loaded(k) and !tile_failed(k)) todo.push_back(k);
+            if (k.level == 0) break;
+            k = { k.level - 1, k.x / 2, k.y / 2 };
+        }
+    }
+
+    std::sort(todo.begin(), todo.end(), [](TileKey a, TileKey b) {
+        return std::tie(a.level, a.y, a.x) < std::tie(b.level, b.y, b.x);
+    });
+
+    todo.erase(std::unique(todo.begin(), todo.end()), todo.end());
+
+    for (auto const& k : todo) {
+        if (m_in_flight >= max_in_flight) return;
+
+        auto& tile = m_tiles[k];
+
+        if (tile.pending) continue;
+
+        tile.pending = true;
+        m_in_flight++;
+
+        TaskPool::global().run_then(
+            this,
+            [source = m_source, k]() { return source->read_tile(k); },
+            [this, k](QImage image) { on_tile_loaded(k, std::move(image)); },
+            [this, k](std::exception_ptr error) {
+                TaskPool::report_error(error);
+
+                // counted as a tile that failed to decode
+                on_tile_loaded(k, QImage());
+            });
+    }
+}
+
+void TiledImagePlot::flush_data() {
+    if (std::exchange(m_focus_changed, false) and m_source) {
+        refine();
+        update_display();
+        evict();
+    }
+
+    request_tiles();
+}
+
+void TiledImagePlot::on_tile_loaded(TileKey k, QImage image) {
+    m_in_flight--;
+
+    auto& tile   = m_tiles[k];
+    tile.pending = false;
+
+    if (image.isNull()) {
+        tile.failed = true;
+
+        qWarning() << "Unable to decode tile" << k.level << k.x << k.y
+                   << "of plot" << m_plot_id;
+    } else {
+        tile.texture  = noo::create_texture(m_doc, image);
+        tile.material = make_image_material(m_doc, tile.texture);
+        tile.mesh     = make_image_quad(m_doc, tile.material, tile_corners(k));
+        tile.bytes    = size_t(image.sizeInBytes());
+        tile.loaded   = true;
+
+        m_loaded_bytes += tile.bytes;
+
+        m_host->note_outbound(image.sizeInBytes());
+    }
+
+    update_display();
+    evict();
+    request_tiles();
+}
+
+void TiledImagePlot::evict() {
+    auto const budget = m_host->options().tile_memory_budget;
+
+    while (m_loaded_bytes + m_source_bytes > budget) {
+        auto victim = m_tiles.end();
+
+        for (auto iter = m_tiles.begin(); iter != m_tiles.end(); ++iter) {
+            auto const& t = iter->second;
+
+            if (!t.loaded or t.obj or t.last_used == m_clock) continue;
+
+            if (victim == m_tiles.end() or
+                t.last_used < victim->second.last_used) {
+                victim = iter;
+            }
+        }
+
+        // everything left is in use
+        if (victim == m_tiles.end()) return;
+
+        m_loaded_bytes -= victim->second.bytes;
+        m_tiles.erase(victim);
+    }
+}
+
+void TiledImagePlot::set_focus(std::optional<Bounds> focus) {
+    if (focus == m_focus) return;
+
+    m_focus = focus;
+
+    // probes move the focus far more often than we can redraw
+    m_focus_changed = true;
+    mark_dirty();
+}
+
+// =============================================================================
+
+TiledImagePlot::TiledImagePlot(Plotty&    host,
+                               int64_t    id,
+                               QByteArray image_data,
+                               glm::vec3  top_left,
+                               glm::vec3  bottom_left,
+                               glm::vec3  bottom_right)
+    : Plot(host, id),
+      m_top_left(top_left),
+      m_bottom_left(bottom_left),
+      m_bottom_right(bottom_right) {
+
+    noo::ObjectData object_data;
+    object_data.name      = QString("Tiled Image %1").arg(m_plot_id);
+    object_data.parent    = host.data_root();
+    object_data.transform = glm::mat4(1);
+
+    m_obj = noo::create_object(m_doc, object_data);
+
+    register_part(m_obj);
+
+    auto const tile_size = host.options().tile_size;
+    auto const budget    = host.options().tile_memory_budget;
+
+    TaskPool::global().run_then(
+        this,
+        [image_data = std::move(image_data), tile_size, budget]() {
+            return TileSource::open(image_data, tile_size, budget);
+        },
+        [this](std::shared_ptr<TileSource const> source) {
+            if (!source) {
+                qWarning() << "Unable to decode image for plot" << m_plot_id;
+                return;
+            }
+
+            m_source       = std::move(source);
+            m_source_bytes = size_t(m_source->decoded.sizeInBytes());
+
+            refine();
+            request_tiles();
+        });
+}
+
+TiledImagePlot::~TiledImagePlot() { }
+
+bool TiledImagePlot::owns_object(noo::ObjectTPtr const& obj) const {
+    if (Plot::owns_object(obj)) return true;
+    if (!obj) return false;
+
+    return std::any_of(m_tiles.begin(), m_tiles.end(), [&obj](auto const& t) {
+        return t.second.obj == obj;
+    });
+}
+
+std::function<void()>
+TiledImagePlot::prepare_selection(SpatialSelection const& sel) {
+    auto focus = selection_focus(sel);
+
+    if (!focus) return {};
+
+    return [this, focus]() { set_focus(focus); };
+}
+
+Plot::ProbeResult TiledImagePlot::handle_probe(glm::vec3 const& probe_point) {
+    // probes come in on a worker thread; refocus on the main thread
+    auto focus = probe_focus(probe_point, probe_focus_radius);
+
+    QMetaObject::invokeMethod(
+        this, [this, focus]() { set_focus(focus); }, Qt::QueuedConnection);
+
+    return {};
+}
@@ -0,0 +1,114 @@
+#ifndef TILEDIMAGEPLOT_H
+#define TILEDIMAGEPLOT_H
+
+#include "plot.h"
+#include "plotty.h"
+
+#include <QImage>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+struct TileSource;
+
+///
+/// \brief A large image on a plane, drawn as a quadtree of tiles.
+///
+/// Level 0 is a single tile covering the whole image; each level below
+/// splits every tile in four, until tiles reach the full resolution. Only a
+/// cut through the tree is shown, refined where the last selection or probe
+/// was. Tiles are decoded on the task pool, coarsest first; a tile stands in
+/// for its children until all of them are ready. Tiles that are not shown
+/// are dropped, least recently used first, once the tile memory budget is
+/// exceeded; an image that had to be decoded whole counts against the budget
+/// too. No new tiles are asked for while over the rate limit.
+///
+class TiledImagePlot : public Plot {
+public:
+    struct TileKey {
+        int level = 0;
+        int x     = 0;
+        int y     = 0;
+
+        bool operator==(TileKey const&) const = default;
+    };
+
+private:
+    struct TileKeyHash {
+        size_t operator()(TileKey const& k) const {
+            return std::hash<uint64_t>()((uint64_t(k.level) << 56) ^
+                                         (uint64_t(k.x) << 28) ^ uint64_t(k.y));
+        }
+    };
+
+    struct Tile {
+        noo::TextureTPtr  texture;
+        noo::MaterialTPtr material;
+        noo::MeshTPtr     mesh;
+        noo::ObjectTPtr   obj; // while shown
+
+        size_t   bytes     = 0;
+        uint64_t last_used = 0;
+        bool     loaded    = false;
+        bool     pending   = false;
+        bool     failed    = false; // not asked for again
+    };
+
+    glm::vec3 m_top_left;
+    glm::vec3 m_bottom_left;
+    glm::vec3 m_bottom_right;
+
+    std::shared_ptr<TileSource const> m_source; // once the header is read
+
+    std::unordered_map<TileKey, Tile, TileKeyHash> m_tiles;
+
+    std::vector<TileKey>  m_cut; // tiles we would like to show
+    std::optional<Bounds> m_focus;
+    bool                  m_focus_changed = false;
+
+    size_t   m_loaded_bytes = 0;
+    size_t   m_source_bytes = 0; // the whole decode, if the source keeps one
+    size_t   m_in_flight    = 0;
+    uint64_t m_clock        = 0;
+
+    bool tile_exists(TileKey) const;
+    bool tile_loaded(TileKey) const;
+    bool tile_failed(TileKey) const;
+
+    std::vector<TileKey>     children(TileKey) const;
+    std::array<glm::vec3, 4> tile_corners(TileKey) const;
+
+    void refine();
+    bool cover(TileKey, std::vector<TileKey>& out) const;
+    void update_display();
+    void request_tiles();
+    void on_tile_loaded(TileKey, QImage);
+    void evict();
+
+    void set_focus(std::optional<Bounds>);
+
+protected:
+    void flush_data() override;
+
+public:
+    TiledImagePlot(Plotty&    host,
+                   int64_t    id,
+                   QByteArray image_data,
+                   glm::vec3  top_left,
+                   glm::vec3  bottom_left,
+                   glm::vec3  bottom_right);
+
+    ~TiledImagePlot() override;
+
+    bool owns_object(noo::ObjectTPtr const&) const override;
+
+    std::function<void()> prepare_selection(SpatialSelection const&) override;
+
+    ProbeResult handle_probe(glm::vec3 const&) override;
+};
+
+#endif // TILEDIMAGEPLOT_H
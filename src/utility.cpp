@@ -1,18 +1,56 @@
 #include "utility.h"
 
+#include "taskpool.h"
+
+#include <limits>
+
+namespace {
+
+size_t const bounds_grain = 1 << 18;
+
+///
+/// \brief Reduce bounds over [0, count) in parallel.
+///
+/// Function is called with a row range, and returns the bounds of it.
+///
+template <class Function>
+std::pair<glm::vec3, glm::vec3> reduce_bounds(size_t count, Function&& f) {
+    auto const num_chunks = (count + bounds_grain - 1) / bounds_grain;
+
+    std::vector<std::pair<glm::vec3, glm::vec3>> partials(num_chunks);
+
+    TaskPool::global().parallel_for(
+        0, count, bounds_grain, [&](size_t b, size_t e) {
+            partials[b / bounds_grain] = f(b, e);
+        });
+
+    auto ret = partials[0];
+
+    for (auto const& [l, h] : partials) {
+        ret.first  = glm::min(ret.first, l);
+        ret.second = glm::max(ret.second, h);
+    }
+
+    return ret;
+}
+
+} // namespace
+
 std::pair<glm::vec3, glm::vec3> min_max_of(std::span<glm::vec3 const> v) {
 
     if (v.empty()) return { {}, {} };
 
-    glm::vec3 lmin = v[0];
-    glm::vec3 lmax = v[0];
+    return reduce_bounds(v.size(), [v](size_t b, size_t e) {
+        glm::vec3 lmin = v[b];
+        glm::vec3 lmax = v[b];
 
-    for (auto const& lv : v) {
-        lmin = glm::min(lv, lmin);
-        lmax = glm::max(lv, lmax);
-    }
+        for (size_t i = b; i < e; i++) {
+            lmin = glm::min(v[i], lmin);
+            lmax = glm::max(v[i], lmax);
+        }
 
-    return { lmin, lmax };
+        return std::pair(lmin, lmax);
+    });
 }
 
 
@@ -21,46 +59,24 @@ std::pair<glm::vec3, glm::vec3> min_max_of(std::span<float const> x,
                                            std::span<float const> z) {
     if (x.empty() or y.empty() or z.empty()) return { {}, {} };
 
-    glm::vec3 lmin(x[0], y[0], z[0]);
-    glm::vec3 lmax(x[0], y[0], z[0]);
+    // per-component loops, so each one vectorizes
+    auto range_of = [](std::span<float const> c, size_t b, size_t e) {
+        float lo = std::numeric_limits<float>::max();
+        float hi = std::numeric_limits<float>::lowest();
 
-    for (size_t i = 0; i < x.size(); i++) {
-        lmin = glm::min(glm::vec3 { x[i], y[i], z[i] }, lmin);
-        lmax = glm::max(glm::vec3 { x[i], y[i], z[i] }, lmax);
-    }
-
-    return { lmin, lmax };
-}
+        for (size_t i = b; i < e; i++) {
+            lo = std::min(lo, c[i]);
+            hi = std::max(hi, c[i]);
+        }
 
-void update_instances(std::span<glm::mat4 const> instances,
-                      noo::DocumentTPtr          doc,
-                      noo::ObjectTPtr            object,
-                      noo::MeshTPtr              mesh) {
-    auto src_bytes = (const char*)instances.data();
+        return std::pair(lo, hi);
+    };
 
-    QByteArray array(src_bytes, instances.size_bytes());
-
-    auto new_buffer = noo::create_buffer(
-        doc,
-        noo::BufferData {
-            .source = noo::BufferInlineSource { .data = array },
-        });
+    return reduce_bounds(x.size(), [=](size_t b, size_t e) {
+        auto [lx, hx] = range_of(x, b, e);
+        auto [ly, hy] = range_of(y, b, e);
+        auto [lz, hz] = range_of(z, b, e);
 
-    auto view = noo::create_buffer_view(doc,
-                                        noo::BufferViewData {
-                                            .source_buffer = new_buffer,
-                                            .type   = noo::ViewType::UNKNOWN,
-                                            .offset = 0,
-                                            .length = (uint64_t)array.size(),
-                                        });
-
-    noo::ObjectUpdateData update { .definition =
-                                       noo::ObjectRenderableDefinition {
-                                           .mesh      = mesh,
-                                           .instances = noo::InstanceInfo {
-                                               .view   = view,
-                                               .stride = 0,
-                                           } } };
-
-    noo::update_object(object, update);
+        return std::pair(glm::vec3(lx, ly, lz), glm::vec3(hx, hy, hz));
+    });
 }
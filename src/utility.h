@@ -5,6 +5,7 @@
 
 #include <noo_server_interface.h>
 
+#include <algorithm>
 #include <span>
 
 std::pair<glm::vec3, glm::vec3> min_max_of(std::span<glm::vec3 const>);
@@ -13,10 +14,14 @@ std::pair<glm::vec3, glm::vec3> min_max_of(std::span<float const> x,
                                            std::span<float const> y,
                                            std::span<float const> z);
 
-void update_instances(std::span<glm::mat4 const> instances,
-                      noo::DocumentTPtr          doc,
-                      noo::ObjectTPtr            object,
-                      noo::MeshTPtr              mesh);
+/// \brief Pack a color with channels in [0, 1] into opaque 8 bit RGBA
+inline glm::u8vec4 pack_color(float r, float g, float b) {
+    auto to_u8 = [](float f) {
+        return uint8_t(std::clamp(f, 0.0f, 1.0f) * 255.0f + .5f);
+    };
+
+    return { to_u8(r), to_u8(g), to_u8(b), 255 };
+}
 
 
 #endif // UTILITY_H